@@ -0,0 +1,511 @@
+#include "analysis.h"
+#include <algorithm>
+#include <stdexcept>
+
+// ---------------- DominatorTree ----------------
+
+DominatorTree::DominatorTree(Function& func, bool post) : post(post) {
+    // 结点 0 为根：正向时是入口块，后支配时是虚拟出口
+    std::vector<BasicBlock*> nodes;
+    std::unordered_map<const BasicBlock*, int> index;
+    auto forward = [&](BasicBlock* bb) { return post ? bb->preds : bb->succs(); };
+
+    std::vector<BasicBlock*> roots;
+    if (post) {
+        for (auto& bb : func.blocks) {
+            auto* term = bb->terminator();
+            if (term && term->op == Opcode::Ret) roots.push_back(bb.get());
+        }
+    }
+    else {
+        roots.push_back(func.entry());
+    }
+
+    // 迭代式 DFS 求后序，避免深层 CFG 递归过深
+    std::vector<BasicBlock*> postorder;
+    std::unordered_set<const BasicBlock*> visited;
+    std::vector<std::pair<BasicBlock*, size_t>> stack;
+    for (auto* root : roots) {
+        if (!visited.insert(root).second) continue;
+        stack.emplace_back(root, 0);
+        while (!stack.empty()) {
+            auto& [bb, next] = stack.back();
+            auto succs = forward(bb);
+            if (next < succs.size()) {
+                BasicBlock* succ = succs[next++];
+                if (visited.insert(succ).second) stack.emplace_back(succ, 0);
+            }
+            else {
+                postorder.push_back(bb);
+                stack.pop_back();
+            }
+        }
+    }
+
+    if (post) nodes.push_back(nullptr);
+    for (auto it = postorder.rbegin(); it != postorder.rend(); ++it) {
+        index[*it] = static_cast<int>(nodes.size());
+        nodes.push_back(*it);
+    }
+    int n = static_cast<int>(nodes.size());
+
+    // 所分析图上的前驱 (后支配时为 CFG 后继，ret 块另有虚拟出口)
+    std::vector<std::vector<int>> preds(n);
+    for (int i = post ? 1 : 0; i < n; ++i) {
+        BasicBlock* bb = nodes[i];
+        auto list = post ? bb->succs() : bb->preds;
+        for (auto* p : list) {
+            auto it = index.find(p);
+            if (it != index.end()) preds[i].push_back(it->second);
+        }
+        if (post) {
+            auto* term = bb->terminator();
+            if (term && term->op == Opcode::Ret) preds[i].push_back(0);
+        }
+    }
+
+    idoms.assign(n, -1);
+    if (n > 0) idoms[0] = 0;
+    auto intersect = [&](int a, int b) {
+        while (a != b) {
+            while (a > b) a = idoms[a];
+            while (b > a) b = idoms[b];
+        }
+        return a;
+    };
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int i = 1; i < n; ++i) {
+            int newIdom = -1;
+            for (int p : preds[i]) {
+                if (idoms[p] < 0) continue;
+                newIdom = newIdom < 0 ? p : intersect(p, newIdom);
+            }
+            if (newIdom >= 0 && idoms[i] != newIdom) {
+                idoms[i] = newIdom;
+                changed = true;
+            }
+        }
+    }
+
+    kids.assign(n, {});
+    frontiers.assign(n, {});
+    for (int i = 1; i < n; ++i) {
+        if (idoms[i] >= 0 && nodes[idoms[i]]) kids[idoms[i]].push_back(nodes[i]);
+    }
+    for (int i = 0; i < n; ++i) {
+        if (preds[i].size() < 2) continue;
+        for (int p : preds[i]) {
+            int runner = p;
+            while (runner != idoms[i] && runner >= 0) {
+                if (nodes[runner] && (frontiers[runner].empty() || frontiers[runner].back() != nodes[i])) {
+                    frontiers[runner].push_back(nodes[i]);
+                }
+                if (runner == 0) break;
+                runner = idoms[runner];
+            }
+        }
+    }
+
+    // 支配树先序/后序编号，用于 O(1) 支配查询
+    dfsIn.assign(n, 0);
+    dfsOut.assign(n, 0);
+    int clock = 0;
+    std::vector<std::pair<int, size_t>> walk;
+    std::vector<std::vector<int>> kidIndex(n);
+    for (int i = 1; i < n; ++i) {
+        if (idoms[i] >= 0) kidIndex[idoms[i]].push_back(i);
+    }
+    if (n > 0) {
+        walk.emplace_back(0, 0);
+        dfsIn[0] = clock++;
+    }
+    while (!walk.empty()) {
+        auto& [node, next] = walk.back();
+        if (next < kidIndex[node].size()) {
+            int child = kidIndex[node][next++];
+            dfsIn[child] = clock++;
+            walk.emplace_back(child, 0);
+        }
+        else {
+            dfsOut[node] = clock++;
+            walk.pop_back();
+        }
+    }
+
+    for (int i = 0; i < n; ++i) {
+        if (nodes[i]) {
+            order[nodes[i]] = i;
+            rpo.push_back(nodes[i]);
+        }
+    }
+}
+
+int DominatorTree::indexOf(const BasicBlock* bb) const {
+    auto it = order.find(bb);
+    return it == order.end() ? -1 : it->second;
+}
+
+bool DominatorTree::isReachable(const BasicBlock* bb) const {
+    return indexOf(bb) >= 0;
+}
+
+BasicBlock* DominatorTree::idom(const BasicBlock* bb) const {
+    int i = indexOf(bb);
+    if (i <= 0 || idoms[i] < 0 || idoms[i] == i) return nullptr;
+    int d = idoms[i];
+    if (post && d == 0) return nullptr;
+    return post ? rpo[d - 1] : rpo[d];
+}
+
+const std::vector<BasicBlock*>& DominatorTree::children(const BasicBlock* bb) const {
+    static const std::vector<BasicBlock*> empty;
+    int i = indexOf(bb);
+    return i < 0 ? empty : kids[i];
+}
+
+const std::vector<BasicBlock*>& DominatorTree::frontier(const BasicBlock* bb) const {
+    static const std::vector<BasicBlock*> empty;
+    int i = indexOf(bb);
+    return i < 0 ? empty : frontiers[i];
+}
+
+bool DominatorTree::dominates(const BasicBlock* a, const BasicBlock* b) const {
+    int ia = indexOf(a), ib = indexOf(b);
+    if (ia < 0 || ib < 0) return false;
+    return dfsIn[ia] <= dfsIn[ib] && dfsOut[ib] <= dfsOut[ia];
+}
+
+bool DominatorTree::dominates(const Instruction* def, const Instruction* use) const {
+    if (def->parent != use->parent) return dominates(def->parent, use->parent);
+    for (auto& inst : def->parent->insts) {
+        if (inst.get() == def) return true;
+        if (inst.get() == use) return false;
+    }
+    return false;
+}
+
+BasicBlock* DominatorTree::nearestCommonDominator(BasicBlock* a, BasicBlock* b) const {
+    int ia = indexOf(a), ib = indexOf(b);
+    if (ia < 0) return b;
+    if (ib < 0) return a;
+    while (ia != ib) {
+        while (ia > ib) ia = idoms[ia];
+        while (ib > ia) ib = idoms[ib];
+    }
+    if (post && ia == 0) return nullptr;
+    return post ? rpo[ia - 1] : rpo[ia];
+}
+
+// ---------------- Loop / LoopInfo ----------------
+
+bool Loop::contains(const Loop* other) const {
+    for (; other; other = other->parent) {
+        if (other == this) return true;
+    }
+    return false;
+}
+
+BasicBlock* Loop::preheader() const {
+    BasicBlock* outside = nullptr;
+    for (auto* pred : header->preds) {
+        if (contains(pred)) continue;
+        if (outside) return nullptr;
+        outside = pred;
+    }
+    if (!outside || outside->succs().size() != 1) return nullptr;
+    return outside;
+}
+
+std::vector<BasicBlock*> Loop::exitingBlocks() const {
+    std::vector<BasicBlock*> result;
+    for (auto* bb : blocks) {
+        for (auto* succ : bb->succs()) {
+            if (!contains(succ)) {
+                result.push_back(bb);
+                break;
+            }
+        }
+    }
+    return result;
+}
+
+std::vector<BasicBlock*> Loop::exitBlocks() const {
+    std::vector<BasicBlock*> result;
+    for (auto* bb : blocks) {
+        for (auto* succ : bb->succs()) {
+            if (!contains(succ) && std::find(result.begin(), result.end(), succ) == result.end()) {
+                result.push_back(succ);
+            }
+        }
+    }
+    return result;
+}
+
+LoopInfo::LoopInfo(Function& func, const DominatorTree& dom) {
+    // 支配树后序：内层循环头先于外层处理
+    std::vector<BasicBlock*> postorder;
+    std::vector<std::pair<BasicBlock*, size_t>> walk{ { func.entry(), 0 } };
+    while (!walk.empty()) {
+        auto& [bb, next] = walk.back();
+        const auto& kids = dom.children(bb);
+        if (next < kids.size()) {
+            walk.emplace_back(kids[next++], 0);
+        }
+        else {
+            postorder.push_back(bb);
+            walk.pop_back();
+        }
+    }
+
+    for (auto* header : postorder) {
+        std::vector<BasicBlock*> worklist;
+        for (auto* pred : header->preds) {
+            if (dom.isReachable(pred) && dom.dominates(header, pred)) worklist.push_back(pred);
+        }
+        if (worklist.empty()) continue;
+
+        loops.push_back(std::make_unique<Loop>(header));
+        Loop* loop = loops.back().get();
+        loop->latches = worklist;
+        innermost[header] = loop;
+
+        // 从回边源反向遍历到 header，已属于内层循环的块整体并入
+        while (!worklist.empty()) {
+            BasicBlock* bb = worklist.back();
+            worklist.pop_back();
+            auto it = innermost.find(bb);
+            if (it == innermost.end()) {
+                innermost[bb] = loop;
+                for (auto* pred : bb->preds) {
+                    if (dom.isReachable(pred)) worklist.push_back(pred);
+                }
+                continue;
+            }
+            Loop* sub = it->second;
+            while (sub->parent) sub = sub->parent;
+            if (sub == loop) continue;
+            sub->parent = loop;
+            for (auto* pred : sub->header->preds) {
+                if (!dom.isReachable(pred)) continue;
+                auto owner = innermost.find(pred);
+                if (owner == innermost.end() || !sub->contains(owner->second)) {
+                    worklist.push_back(pred);
+                }
+            }
+        }
+    }
+
+    // 计算嵌套关系、深度与完整块集合 (按 CFG 逆后序排列块)
+    for (auto& loop : loops) {
+        if (loop->parent) loop->parent->subLoops.push_back(loop.get());
+        else topLevel.push_back(loop.get());
+    }
+    for (auto* bb : dom.reversePostOrder()) {
+        auto it = innermost.find(bb);
+        if (it == innermost.end()) continue;
+        for (Loop* l = it->second; l; l = l->parent) {
+            l->blocks.push_back(bb);
+            l->blockSet.insert(bb);
+        }
+    }
+    for (auto& loop : loops) {
+        int depth = 1;
+        for (Loop* p = loop->parent; p; p = p->parent) ++depth;
+        loop->depth = depth;
+        // header 排在首位
+        auto pos = std::find(loop->blocks.begin(), loop->blocks.end(), loop->header);
+        if (pos != loop->blocks.end()) std::rotate(loop->blocks.begin(), pos, pos + 1);
+    }
+}
+
+Loop* LoopInfo::loopFor(const BasicBlock* bb) const {
+    auto it = innermost.find(bb);
+    return it == innermost.end() ? nullptr : it->second;
+}
+
+int LoopInfo::loopDepth(const BasicBlock* bb) const {
+    Loop* loop = loopFor(bb);
+    return loop ? loop->depth : 0;
+}
+
+bool LoopInfo::isLoopHeader(const BasicBlock* bb) const {
+    Loop* loop = loopFor(bb);
+    return loop && loop->header == bb;
+}
+
+std::vector<Loop*> LoopInfo::loopsInnermostFirst() const {
+    std::vector<Loop*> result;
+    std::vector<std::pair<Loop*, size_t>> walk;
+    for (auto* top : topLevel) {
+        walk.emplace_back(top, 0);
+        while (!walk.empty()) {
+            auto& [loop, next] = walk.back();
+            if (next < loop->subLoops.size()) {
+                walk.emplace_back(loop->subLoops[next++], 0);
+            }
+            else {
+                result.push_back(loop);
+                walk.pop_back();
+            }
+        }
+    }
+    return result;
+}
+
+BasicBlock* ensurePreheader(Function& func, Loop* loop) {
+    if (auto* pre = loop->preheader()) return pre;
+
+    BasicBlock* header = loop->header;
+    std::vector<BasicBlock*> outside;
+    for (auto* pred : header->preds) {
+        if (!loop->contains(pred)) outside.push_back(pred);
+    }
+
+    // 新块放在第一个循环外前驱之后
+    auto pos = std::find_if(func.blocks.begin(), func.blocks.end(),
+        [&](const std::unique_ptr<BasicBlock>& bb) { return outside.empty() || bb.get() == outside.front(); });
+    auto owned = std::make_unique<BasicBlock>(&func, func.parent->newLabel("preheader"));
+    BasicBlock* pre = owned.get();
+    func.blocks.insert(pos == func.blocks.end() ? pos : pos + 1, std::move(owned));
+
+    // header 中每个 phi 的循环外来源合并到前置块中的新 phi
+    for (auto& inst : header->insts) {
+        if (!inst->isPhi()) break;
+        Value* merged = nullptr;
+        auto newPhi = makeInst(Opcode::Phi, inst->type);
+        bool allSame = true;
+        for (auto* pred : outside) {
+            Value* v = inst->getIncomingValue(pred);
+            newPhi->addIncoming(v, pred);
+            if (merged && merged != v) allSame = false;
+            merged = v;
+        }
+        for (auto* pred : outside) {
+            inst->removeIncoming(pred);
+        }
+        if (allSame) {
+            inst->addIncoming(merged, pre);
+        }
+        else {
+            inst->addIncoming(pre->append(std::move(newPhi)), pre);
+        }
+    }
+
+    for (auto* pred : outside) {
+        pred->terminator()->replaceBlock(header, pre);
+    }
+    auto br = makeInst(Opcode::Br, IRType::Void);
+    br->blocks.push_back(header);
+    pre->append(std::move(br));
+
+    // 前置块在各外层循环之内
+    for (Loop* outer = loop->parent; outer; outer = outer->parent) {
+        outer->blocks.push_back(pre);
+        outer->blockSet.insert(pre);
+    }
+    func.recomputePreds();
+    return pre;
+}
+
+// ---------------- AnalysisManager ----------------
+
+DominatorTree& AnalysisManager::domTree() {
+    if (dom) {
+        ++cached;
+        return *dom;
+    }
+    ++computed;
+    dom = std::make_unique<DominatorTree>(func, false);
+    return *dom;
+}
+
+DominatorTree& AnalysisManager::postDomTree() {
+    if (postDom) {
+        ++cached;
+        return *postDom;
+    }
+    ++computed;
+    postDom = std::make_unique<DominatorTree>(func, true);
+    return *postDom;
+}
+
+LoopInfo& AnalysisManager::loopInfo() {
+    if (loops) {
+        ++cached;
+        return *loops;
+    }
+    auto& d = domTree();
+    ++computed;
+    loops = std::make_unique<LoopInfo>(func, d);
+    return *loops;
+}
+
+Liveness& AnalysisManager::liveness() {
+    if (live) {
+        ++cached;
+        return *live;
+    }
+    ++computed;
+    live = std::make_unique<Liveness>(func);
+    return *live;
+}
+
+void AnalysisManager::invalidate(Preserved preserved) {
+    // 活跃信息依赖指令本身，任何修改都需重算
+    if (preserved != Preserved::All) {
+        live.reset();
+    }
+    if (preserved == Preserved::None) {
+        dom.reset();
+        postDom.reset();
+        loops.reset();
+    }
+}
+
+// ---------------- 打印 ----------------
+
+void printAnalyses(std::ostream& os, AnalysisManager& am) {
+    Function& func = am.function();
+    auto& dom = am.domTree();
+    auto& pdom = am.postDomTree();
+    auto& li = am.loopInfo();
+    auto& live = am.liveness();
+
+    auto name = [](const BasicBlock* bb) { return bb ? bb->name : std::string("-"); };
+    os << "analyses for @" << func.name << ":\n";
+    for (auto& bb : func.blocks) {
+        os << "    " << bb->name << ": idom=" << name(dom.idom(bb.get()))
+            << " ipdom=" << name(pdom.idom(bb.get()))
+            << " depth=" << li.loopDepth(bb.get()) << " df={";
+        const auto& df = dom.frontier(bb.get());
+        for (size_t i = 0; i < df.size(); ++i) {
+            os << (i ? " " : "") << df[i]->name;
+        }
+        os << "}";
+        if (dom.isReachable(bb.get())) {
+            os << " live-in={";
+            bool first = true;
+            live.liveIn(bb.get()).forEach([&](size_t id) {
+                os << (first ? "" : " ") << "%" << id;
+                first = false;
+            });
+            os << "}";
+        }
+        os << "\n";
+    }
+    for (auto* loop : li.loopsInnermostFirst()) {
+        os << "    loop " << loop->header->name << " depth=" << loop->depth
+            << " preheader=" << name(loop->preheader()) << " blocks={";
+        for (size_t i = 0; i < loop->blocks.size(); ++i) {
+            os << (i ? " " : "") << loop->blocks[i]->name;
+        }
+        os << "} exits={";
+        auto exits = loop->exitBlocks();
+        for (size_t i = 0; i < exits.size(); ++i) {
+            os << (i ? " " : "") << exits[i]->name;
+        }
+        os << "}\n";
+    }
+}
@@ -0,0 +1,120 @@
+#pragma once
+#include "ir.h"
+#include "dataflow.h"
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <memory>
+#include <ostream>
+
+// 支配树 (Cooper-Harvey-Kennedy 迭代算法)。
+// post 为 true 时在反向 CFG 上计算后支配树，所有 ret 块连到一个虚拟出口。
+class DominatorTree {
+public:
+    DominatorTree(Function& func, bool post = false);
+
+    bool isPostDominator() const { return post; }
+    bool isReachable(const BasicBlock* bb) const;
+    BasicBlock* idom(const BasicBlock* bb) const;   // 根或不可达块返回 nullptr
+    const std::vector<BasicBlock*>& children(const BasicBlock* bb) const;
+    const std::vector<BasicBlock*>& frontier(const BasicBlock* bb) const;
+
+    // a 是否 (后) 支配 b，块自身支配自身
+    bool dominates(const BasicBlock* a, const BasicBlock* b) const;
+    bool dominates(const Instruction* def, const Instruction* use) const;
+    BasicBlock* nearestCommonDominator(BasicBlock* a, BasicBlock* b) const;
+
+    // 计算所用图上的逆后序 (后支配树为反向 CFG 的逆后序)
+    const std::vector<BasicBlock*>& reversePostOrder() const { return rpo; }
+
+private:
+    bool post;
+    std::vector<BasicBlock*> rpo;
+    std::unordered_map<const BasicBlock*, int> order;      // 逆后序编号
+    std::vector<int> idoms;                                 // 按逆后序编号，虚拟出口为 -1
+    std::vector<std::vector<BasicBlock*>> kids;
+    std::vector<std::vector<BasicBlock*>> frontiers;
+    std::vector<int> dfsIn, dfsOut;                          // 支配树上的先序/后序区间
+
+    int indexOf(const BasicBlock* bb) const;
+};
+
+class Loop {
+public:
+    explicit Loop(BasicBlock* h) : header(h) {}
+
+    BasicBlock* header;
+    Loop* parent = nullptr;
+    std::vector<Loop*> subLoops;
+    std::vector<BasicBlock*> blocks;          // 含子循环中的块，首块为 header
+    std::unordered_set<const BasicBlock*> blockSet;
+    std::vector<BasicBlock*> latches;          // 回边源块
+    int depth = 1;
+
+    bool contains(const BasicBlock* bb) const { return blockSet.count(bb) != 0; }
+    bool contains(const Loop* other) const;
+
+    // 循环外唯一前驱且其唯一后继为 header 时即为前置块，否则为 nullptr
+    BasicBlock* preheader() const;
+    std::vector<BasicBlock*> exitingBlocks() const;   // 有边离开循环的块
+    std::vector<BasicBlock*> exitBlocks() const;      // 循环外的出口目标块 (去重)
+};
+
+// 自然循环森林
+class LoopInfo {
+public:
+    LoopInfo(Function& func, const DominatorTree& dom);
+
+    const std::vector<Loop*>& topLevelLoops() const { return topLevel; }
+    Loop* loopFor(const BasicBlock* bb) const;    // 最内层循环
+    int loopDepth(const BasicBlock* bb) const;
+    bool isLoopHeader(const BasicBlock* bb) const;
+
+    // 内层循环先于外层 (适合由内向外的变换)
+    std::vector<Loop*> loopsInnermostFirst() const;
+    size_t size() const { return loops.size(); }
+
+private:
+    std::vector<std::unique_ptr<Loop>> loops;
+    std::vector<Loop*> topLevel;
+    std::unordered_map<const BasicBlock*, Loop*> innermost;
+};
+
+// 为循环插入前置块：循环外的前驱统一改为跳转到新块，header 中的 phi 相应合并。
+// 返回前置块 (已存在时直接返回)，调用者负责让 CFG 分析失效。
+// 新块同时加入各外层循环的 blocks，由内向外为多个循环建立前置块时可沿用同一份循环信息
+// (支配树与 LoopInfo::loopFor 不反映新块)
+BasicBlock* ensurePreheader(Function& func, Loop* loop);
+
+// 变换对已有分析结果的保持程度
+enum class Preserved {
+    All,     // 未修改 IR
+    CFG,     // 只改了指令，CFG 不变
+    None     // CFG 已改变
+};
+
+// 缓存函数级分析结果，变换后按 Preserved 让失效的结果重算
+class AnalysisManager {
+public:
+    explicit AnalysisManager(Function& func) : func(func) {}
+
+    Function& function() { return func; }
+    DominatorTree& domTree();
+    DominatorTree& postDomTree();
+    LoopInfo& loopInfo();
+    Liveness& liveness();
+
+    void invalidate(Preserved preserved);
+
+    int computed = 0;   // 实际重新计算的次数
+    int cached = 0;     // 命中缓存的次数
+
+private:
+    Function& func;
+    std::unique_ptr<DominatorTree> dom;
+    std::unique_ptr<DominatorTree> postDom;
+    std::unique_ptr<LoopInfo> loops;
+    std::unique_ptr<Liveness> live;
+};
+
+void printAnalyses(std::ostream& os, AnalysisManager& am);
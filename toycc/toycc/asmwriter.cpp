@@ -0,0 +1,108 @@
+#include "asmwriter.h"
+#include <algorithm>
+#include <cstring>
+
+AsmWriter::AsmWriter(std::ostream& out)
+    : out(out), current(new char[ChunkSize]), worker(&AsmWriter::run, this) {}
+
+AsmWriter::~AsmWriter() {
+    flush();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    ready.notify_one();
+    worker.join();
+}
+
+AsmWriter& AsmWriter::operator<<(std::string_view s) {
+    while (!s.empty()) {
+        if (pos == ChunkSize) submit();
+        size_t n = std::min(s.size(), ChunkSize - pos);
+        std::memcpy(current.get() + pos, s.data(), n);
+        pos += n;
+        s.remove_prefix(n);
+    }
+    return *this;
+}
+
+// 自低位起每次转换两位十进制数，写入临时缓冲后整体复制
+AsmWriter& AsmWriter::operator<<(int value) {
+    static const char digits[] =
+        "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+        "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+        "8081828384858687888990919293949596979899";
+    char buf[12];
+    char* end = buf + sizeof(buf);
+    char* p = end;
+    uint32_t u = value < 0 ? 0u - static_cast<uint32_t>(value) : static_cast<uint32_t>(value);
+    while (u >= 100) {
+        uint32_t r = u % 100;
+        u /= 100;
+        *--p = digits[r * 2 + 1];
+        *--p = digits[r * 2];
+    }
+    if (u >= 10) {
+        *--p = digits[u * 2 + 1];
+        *--p = digits[u * 2];
+    }
+    else {
+        *--p = static_cast<char>('0' + u);
+    }
+    if (value < 0) *--p = '-';
+    return *this << std::string_view(p, static_cast<size_t>(end - p));
+}
+
+void AsmWriter::putHex(uint32_t value) {
+    char buf[8];
+    char* end = buf + sizeof(buf);
+    char* p = end;
+    do {
+        *--p = "0123456789abcdef"[value & 0xf];
+        value >>= 4;
+    } while (value != 0);
+    *this << std::string_view(p, static_cast<size_t>(end - p));
+}
+
+// 当前块交给后台线程，换上一个回收的空块 (没有时才分配)
+void AsmWriter::submit() {
+    if (pos == 0) return;
+    std::unique_ptr<char[]> next;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending.emplace_back(std::move(current), pos);
+        if (!freeChunks.empty()) {
+            next = std::move(freeChunks.back());
+            freeChunks.pop_back();
+        }
+    }
+    ready.notify_one();
+    current = next ? std::move(next) : std::unique_ptr<char[]>(new char[ChunkSize]);
+    written += pos;
+    pos = 0;
+}
+
+void AsmWriter::flush() {
+    submit();
+    std::unique_lock<std::mutex> lock(mutex);
+    drained.wait(lock, [&]() { return pending.empty() && !writing; });
+    lock.unlock();
+    out.flush();
+}
+
+void AsmWriter::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        ready.wait(lock, [&]() { return stopping || !pending.empty(); });
+        if (pending.empty()) return;
+        auto [chunk, size] = std::move(pending.front());
+        pending.pop_front();
+        writing = true;
+        lock.unlock();
+        out.write(chunk.get(), static_cast<std::streamsize>(size));
+        lock.lock();
+        writing = false;
+        freeChunks.push_back(std::move(chunk));
+        if (pending.empty()) drained.notify_all();
+    }
+}
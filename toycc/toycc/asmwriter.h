@@ -0,0 +1,53 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// 汇编输出缓冲：文本直接格式化进预先分配的大块内存，整数不经 std::to_string；
+// 写满的块交给后台线程写入输出流，写完后回收复用，稳定后不再分配内存
+class AsmWriter {
+public:
+    static constexpr size_t ChunkSize = 64 * 1024;
+
+    explicit AsmWriter(std::ostream& out);
+    ~AsmWriter();
+    AsmWriter(const AsmWriter&) = delete;
+    AsmWriter& operator=(const AsmWriter&) = delete;
+
+    AsmWriter& operator<<(char c) {
+        if (pos == ChunkSize) submit();
+        current[pos++] = c;
+        return *this;
+    }
+    AsmWriter& operator<<(std::string_view s);
+    AsmWriter& operator<<(int value);
+    void putHex(uint32_t value);
+
+    // 提交当前块并等待后台线程写完所有块
+    void flush();
+    size_t bytesWritten() const { return written + pos; }
+
+private:
+    std::ostream& out;
+    std::unique_ptr<char[]> current;
+    size_t pos = 0;
+    size_t written = 0;   // 已提交的字节数
+
+    std::mutex mutex;
+    std::condition_variable ready;     // 有待写的块或要求退出
+    std::condition_variable drained;   // 待写队列已清空
+    std::deque<std::pair<std::unique_ptr<char[]>, size_t>> pending;
+    std::vector<std::unique_ptr<char[]>> freeChunks;
+    bool writing = false;
+    bool stopping = false;
+    std::thread worker;
+
+    void submit();
+    void run();
+};
@@ -0,0 +1,95 @@
+#!/usr/bin/env python3
+# 生成规模可调的 ToyC 基准程序，用于测量编译各阶段开销随输入规模的变化
+# 用法: python gen_bench.py <kind> <n> > out.tc
+#   stmts    : n 条直线型算术语句
+#   branches : 循环体内 n 个 if/else，基本块数约为 3n
+#   loops    : n 个顺序排列的两层嵌套循环
+#   consts   : n 组经过分支合并与循环传递的常量，以及由它们决定的分支
+# 配合 toyc --time-passes 使用；branches/loops 取 n=1000 以上可得到数千个基本块的函数，
+# 用于比较数据流求解器在稠密/稀疏位向量下的开销
+import sys
+
+
+def gen_stmts(n):
+    lines = ["int main() {", "    int a = 1;", "    int b = 2;", "    int c = 3;"]
+    for i in range(n):
+        x, y, z = "abc"[i % 3], "abc"[(i + 1) % 3], "abc"[(i + 2) % 3]
+        lines.append(f"    {x} = ({x} + {y} * {i % 7 + 1}) % 10007 - {z} / {i % 5 + 1};")
+    lines.append("    return a + b + c;")
+    lines.append("}")
+    return lines
+
+
+def gen_branches(n):
+    lines = ["int main() {", "    int s = 0;", "    int i = 0;", "    while (i < 100) {"]
+    for k in range(n):
+        lines.append(f"        if (i % {k % 13 + 2} == {k % 3}) {{")
+        lines.append(f"            s = s + {k % 17 + 1};")
+        lines.append("        } else {")
+        lines.append(f"            s = s - i / {k % 5 + 1};")
+        lines.append("        }")
+    lines += ["        i = i + 1;", "    }", "    return s;", "}"]
+    return lines
+
+
+def gen_loops(n):
+    lines = ["int main() {", "    int s = 0;"]
+    for k in range(n):
+        lines += [
+            f"    int i{k} = 0;",
+            f"    while (i{k} < {k % 7 + 10}) {{",
+            f"        int j{k} = 0;",
+            f"        while (j{k} < i{k}) {{",
+            f"            s = (s + i{k} * j{k} + {k}) % 65521;",
+            f"            j{k} = j{k} + 1;",
+            "        }",
+            f"        i{k} = i{k} + 1;",
+            "    }",
+        ]
+    lines += ["    return s;", "}"]
+    return lines
+
+
+def gen_consts(n):
+    lines = ["int main() {", "    int s = 0;"]
+    for k in range(n):
+        d, c = k % 5 + 1, k % 7
+        lines += [
+            f"    int d{k} = {d};",
+            f"    int m{k} = 0;",
+            f"    if (s > 1000000) {{",
+            f"        m{k} = d{k} * 2;",
+            "    } else {",
+            f"        m{k} = d{k} + d{k};",
+            "    }",
+            f"    int c{k} = {c};",
+            f"    int j{k} = 0;",
+            f"    while (j{k} < 3) {{",
+            f"        c{k} = {c};",
+            f"        s = (s + j{k}) % 65521;",
+            f"        j{k} = j{k} + 1;",
+            "    }",
+            f"    if (c{k} == {c} && m{k} == {2 * d}) {{",
+            f"        s = s + m{k} + c{k};",
+            "    } else {",
+            "        s = s - 1;",
+            "    }",
+        ]
+    lines += ["    return s % 256;", "}"]
+    return lines
+
+
+def main():
+    if len(sys.argv) != 3:
+        print(__doc__ or "usage: gen_bench.py <stmts|branches|loops|consts> <n>", file=sys.stderr)
+        sys.exit(1)
+    kind, n = sys.argv[1], int(sys.argv[2])
+    gens = {"stmts": gen_stmts, "branches": gen_branches, "loops": gen_loops, "consts": gen_consts}
+    if kind not in gens:
+        print("unknown kind: " + kind, file=sys.stderr)
+        sys.exit(1)
+    print("\n".join(gens[kind](n)))
+
+
+if __name__ == "__main__":
+    main()
@@ -1,202 +1,745 @@
 #include "codegen.h"
-#include <sstream>
+#include "layout.h"
+#include <algorithm>
 #include <stdexcept>
+#include <tuple>
+#include <cstdint>
 
-CodeGen::CodeGen(std::ostream& out) : out(out) {}
+// ѭͷ 16 ֽ (ȡָ) 
+static constexpr int kLoopAlign = 4;
 
-void CodeGen::emit(const std::string& line) {
-    out << "    " << line << "\n";
+// ָ֧ zero ȽʱдɶӦαָ
+static MachineInstr branchInst(MOp op, Reg lhs, Reg rhs, std::string_view label) {
+    if (rhs == Reg::zero) {
+        switch (op) {
+        case MOp::Beq: return MachineInstr::branch(MOp::Beqz, lhs, Reg::None, label);
+        case MOp::Bne: return MachineInstr::branch(MOp::Bnez, lhs, Reg::None, label);
+        case MOp::Blt: return MachineInstr::branch(MOp::Bltz, lhs, Reg::None, label);
+        default: return MachineInstr::branch(MOp::Bgez, lhs, Reg::None, label);
+        }
+    }
+    if (lhs == Reg::zero && op == MOp::Blt) return MachineInstr::branch(MOp::Bgtz, rhs, Reg::None, label);
+    if (lhs == Reg::zero && op == MOp::Bge) return MachineInstr::branch(MOp::Blez, rhs, Reg::None, label);
+    return MachineInstr::branch(op, lhs, rhs, label);
 }
 
-std::string CodeGen::newLabel(const std::string& base) {
-    return base + "_" + std::to_string(labelCount++);
+CodeGen::CodeGen(std::ostream& out, RegAllocKind allocKind, bool runPeephole, bool layout)
+    : writer(out), printer(writer), allocKind(allocKind), runPeephole(runPeephole), layout(layout) {}
+
+void CodeGen::emit(const MachineInstr& mi) {
+    mfunc.code.push_back(mi);
 }
 
-void CodeGen::resetStack() {
-    varOffsets.clear();
-    stackOffset = 0;
-    breakLabels.clear();
-    continueLabels.clear();
+// һϣŻָͳƷô뿽
+void CodeGen::flush() {
+    if (runPeephole) peephole.run(mfunc.code);
+    printer.print(mfunc);
+    if (simulator) simulator->load(mfunc);
+    for (auto& mi : mfunc.code) {
+        if (mi.isLabel()) continue;
+        ++stats.instructions;
+        if (mi.op == MOp::Lw) ++stats.loads;
+        else if (mi.op == MOp::Sw) ++stats.stores;
+        else if (mi.op == MOp::Mv) ++stats.moves;
+    }
+    mfunc.code.clear();
 }
 
-void CodeGen::allocVar(const std::string& name) {
-    stackOffset -= 4;
-    varOffsets[name] = stackOffset;
+std::string_view CodeGen::blockLabel(const BasicBlock* bb) const {
+    return bb->name;
 }
 
-void CodeGen::generate(const std::vector<std::shared_ptr<FuncDef>>& funcs) {
-    emit(".text");
+void CodeGen::generate(Module& module) {
+    printer.printHeader();
 
     // ҵmain
-    std::shared_ptr<FuncDef> mainFunc = nullptr;
-    for (const auto& func : funcs) {
-        if (func->name == "main") {
-            mainFunc = func;
-            break;
-        }
-    }
-
+    Function* mainFunc = module.getFunction("main");
     if (!mainFunc) {
         throw std::runtime_error("main function not found");
     }
-    genFunc(mainFunc);
+    genFunc(*mainFunc);
 
     // 
-    for (const auto& func : funcs) {
+    for (auto& func : module.functions) {
         if (func->name != "main") {
-            genFunc(func);
+            genFunc(*func);
+        }
+    }
+    writer.flush();
+}
+
+// Ҫջ֡Ŀ󱣴ָ㣺֧䡢ָ֧Щ飬߿Ƶȼ
+// ѭУӶÿεøִһλ򶼲ִСصĻָΪձʾװ
+static std::pair<BasicBlock*, BasicBlock*> findSaveRestore(const std::vector<BasicBlock*>& needs, AnalysisManager& am) {
+    auto& dom = am.domTree();
+    auto& pdom = am.postDomTree();
+    auto& loops = am.loopInfo();
+    std::pair<BasicBlock*, BasicBlock*> none{ am.function().entry(), nullptr };
+    if (needs.empty()) return none;
+
+    BasicBlock* save = needs.front();
+    BasicBlock* restore = needs.front();
+    for (auto* bb : needs) {
+        // ˳ڵĿ (ѭ) ޷ȷָ
+        if (!pdom.isReachable(bb)) return none;
+        save = dom.nearestCommonDominator(save, bb);
+        restore = pdom.nearestCommonDominator(restore, bb);
+        if (!restore) return none;
+    }
+    while (true) {
+        while (loops.loopDepth(save) > 0) save = dom.idom(save);
+        while (restore && loops.loopDepth(restore) > 0) restore = pdom.idom(restore);
+        if (!restore) return none;
+        if (dom.dominates(save, restore) && pdom.dominates(restore, save)) return { save, restore };
+        save = dom.nearestCommonDominator(save, restore);
+        restore = pdom.nearestCommonDominator(restore, save);
+        if (!restore) return none;
+    }
+}
+
+// װ׼ö֮ĳ֮£ڱѻԾĲһݣ
+// ֧ʹøøԽõֻǸԭ a ĴУ
+// ֮ǰĿ·ض s Ĵ
+static void splitArgumentsAtSavePoint(Function& func, AnalysisManager& am) {
+    std::vector<BasicBlock*> callBlocks;
+    for (auto& bb : func.blocks) {
+        for (auto& inst : bb->insts) {
+            if (inst->op == Opcode::Call) {
+                callBlocks.push_back(bb.get());
+                break;
+            }
+        }
+    }
+    auto [save, restore] = findSaveRestore(callBlocks, am);
+    if (!restore || save == func.entry()) return;
+
+    auto& live = am.liveness();
+    auto& dom = am.domTree();
+    bool changed = false;
+    for (auto& arg : func.args) {
+        if (arg->index >= 8 || !live.isLiveIn(arg.get(), save)) continue;
+        Instruction* copy = save->insertAfterPhis(makeInst(Opcode::Copy, IRType::I32, { arg.get() }));
+        std::vector<Instruction*> users = arg->users;
+        for (auto* user : users) {
+            if (user == copy) continue;
+            for (size_t i = 0; i < user->operands.size(); ++i) {
+                if (user->operands[i] != arg.get()) continue;
+                BasicBlock* useBlock = user->isPhi() ? user->blocks[i] : user->parent;
+                if (dom.dominates(save, useBlock)) user->setOperand(i, copy);
+            }
+        }
+        changed = true;
+    }
+    if (changed) am.invalidate(Preserved::CFG);
+}
+
+void CodeGen::genFunc(Function& func) {
+    stats = Stats();
+
+    // phi ǰĩβǰжʱȲָñ
+    func.removeUnreachableBlocks();
+    std::vector<std::pair<BasicBlock*, BasicBlock*>> edges;
+    for (auto& bb : func.blocks) {
+        if (bb->insts.empty() || !bb->insts.front()->isPhi()) continue;
+        for (auto* pred : bb->preds) {
+            if (pred->succs().size() > 1) edges.emplace_back(pred, bb.get());
+        }
+    }
+    for (auto& [from, to] : edges) {
+        func.splitEdge(from, to);
+    }
+
+    AnalysisManager am(func);
+    // ֳıһ벼ֲ֣ı CFGķȻЧ
+    alignedBlocks.clear();
+    if (layout) alignedBlocks = layoutBlocks(func, am).alignedHeaders;
+    splitArgumentsAtSavePoint(func, am);
+    alloc = allocateRegisters(func, am, allocKind);
+    stats.spilledValues = static_cast<int>(alloc.spillSlots.size());
+    stats.stackValues = static_cast<int>(alloc.spillSlots.size() + alloc.saveSlots.size());
+    stats.stackSlots = alloc.numSpillSlots;
+
+    // ջ֡¶ϣջϲۡ߱Ĵra (Ҷ)
+    bool hasCalls = false;
+    int outgoing = 0;
+    for (auto& bb : func.blocks) {
+        for (auto& inst : bb->insts) {
+            if (inst->op != Opcode::Call) continue;
+            hasCalls = true;
+            outgoing = std::max(outgoing, static_cast<int>(inst->operands.size()) - 8);
         }
     }
+    spillBase = outgoing * 4;
+    int offset = spillBase + alloc.numSpillSlots * 4;
+    savedRegs.clear();
+    for (auto& reg : alloc.calleeSaved) {
+        savedRegs.emplace_back(reg, offset);
+        offset += 4;
+    }
+    if (hasCalls) {
+        savedRegs.emplace_back(Reg::ra, offset);
+        offset += 4;
+    }
+    frameSize = (offset + 15) / 16 * 16;
+    stats.frameSize = frameSize;
+    stats.unsharedFrameSize = (offset + (stats.stackValues - stats.stackSlots) * 4 + 15) / 16 * 16;
+
+    // Ҷʱûջֻ֡ȷʵҪջ֡·Ͻ
+    saveBlock = func.entry();
+    restoreBlock = nullptr;
+    if (frameSize > 0) {
+        std::tie(saveBlock, restoreBlock) = findSaveRestore(frameBlocks(func), am);
+        if (!restoreBlock) saveBlock = func.entry();
+    }
+
+    mfunc.name = func.name;
+    if (saveBlock == func.entry()) {
+        genPrologue();
+    }
+
+    // ǰ 8  a0-a7 Уڵջ֡ײ
+    std::vector<Move> moves;
+    for (auto& arg : func.args) {
+        Location src;
+        if (arg->index < 8) src.reg = argReg(arg->index);
+        else src = stackArgLocation(arg->index, true);
+        moves.push_back({ locationOf(arg.get()), src });
+    }
+    genParallelMoves(moves);
+
+    // δװʱ ret ͬһβһ֮һ ret ֱ
+    epilogueLabel = frameSize > 0 && !restoreBlock ? func.parent->newLabel("epilogue") : "";
+    for (size_t i = 0; i < func.blocks.size(); ++i) {
+        BasicBlock* next = i + 1 < func.blocks.size() ? func.blocks[i + 1].get() : nullptr;
+        genBlock(func.blocks[i].get(), next);
+    }
+    if (!epilogueLabel.empty()) {
+        emit(MachineInstr::labelDef(epilogueLabel));
+        genEpilogue();
+    }
+
+    flush();
+    perFunction.emplace_back(func.name, stats);
+    total.instructions += stats.instructions;
+    total.loads += stats.loads;
+    total.stores += stats.stores;
+    total.moves += stats.moves;
+    total.spilledValues += stats.spilledValues;
+    total.stackValues += stats.stackValues;
+    total.stackSlots += stats.stackSlots;
+    total.frameSize += stats.frameSize;
+    total.unsharedFrameSize += stats.unsharedFrameSize;
 }
 
-void CodeGen::genFunc(const std::shared_ptr<FuncDef>& func) {
-    resetStack();
-    if (func->name == "main") {
-        emit(".globl main");
+void CodeGen::genBlock(BasicBlock* bb, BasicBlock* next) {
+    if (bb != bb->parent->entry()) {
+        emit(MachineInstr::labelDef(blockLabel(bb), alignedBlocks.count(bb) ? kLoopAlign : 0));
+        if (bb == saveBlock) genPrologue();
     }
-    emit(func->name + ":");
-    emit("addi sp, sp, -256");
+    for (auto& inst : bb->insts) {
+        genInst(inst.get(), next);
+    }
+}
 
-    for (const auto& param : func->params) {
-        allocVar(param.name);
+void CodeGen::genPrologue() {
+    adjustSp(-frameSize);
+    for (auto& [reg, slot] : savedRegs) {
+        emitMem(MOp::Sw, reg, slot);
     }
+}
 
-    genBlock(func->body);
+void CodeGen::genRestore() {
+    for (auto& [reg, slot] : savedRegs) {
+        emitMem(MOp::Lw, reg, slot);
+    }
+    adjustSp(frameSize);
+}
 
-    emit("addi sp, sp, 256");
-    emit("ret");
+void CodeGen::genEpilogue() {
+    genRestore();
+    emit(MachineInstr::ret());
 }
 
-void CodeGen::genBlock(const std::shared_ptr<BlockStmt>& block) {
-    for (const auto& stmt : block->statements) {
-        genStmt(stmt);
+// Ҫջ֡Ŀ飺áۻ s Ĵ (ĩβ phi )
+//  s ĴۻջʱڿҲҪ
+std::vector<BasicBlock*> CodeGen::frameBlocks(Function& func) const {
+    auto touchesFrame = [&](const Value* v) {
+        if (v->isConstant() || isFusedCompare(v)) return false;
+        auto it = alloc.regs.find(v);
+        return it == alloc.regs.end() || isCalleeSaved(it->second);
+    };
+    std::vector<BasicBlock*> result;
+    for (auto& bb : func.blocks) {
+        bool needs = false;
+        if (bb.get() == func.entry()) {
+            for (auto& arg : func.args) {
+                needs = needs || arg->index >= 8 || touchesFrame(arg.get());
+            }
+        }
+        for (auto& inst : bb->insts) {
+            if (needs) break;
+            if (inst->isPhi()) continue;
+            needs = inst->op == Opcode::Call || (inst->type != IRType::Void && touchesFrame(inst.get()));
+            for (auto* op : inst->operands) {
+                needs = needs || touchesFrame(op);
+            }
+        }
+        for (auto* succ : bb->succs()) {
+            for (auto& inst : succ->insts) {
+                if (needs || !inst->isPhi()) break;
+                needs = touchesFrame(inst.get()) || touchesFrame(inst->getIncomingValue(bb.get()));
+            }
+        }
+        if (needs) result.push_back(bb.get());
     }
+    return result;
 }
 
-void CodeGen::genStmt(const std::shared_ptr<Stmt>& stmt) {
-    if (!stmt) return;
+void CodeGen::genInst(Instruction* inst, BasicBlock* next) {
+    if (isFusedCompare(inst)) {
+        return;   //  condbr ֧һͬ
+    }
+    switch (inst->op) {
+    case Opcode::Phi:
+        // ǰĩβĿ
+        break;
+    case Opcode::Copy:
+    case Opcode::ZExt:
+        emitMove(locationOf(inst), locationOf(inst->getOperand(0)));
+        break;
+    case Opcode::Call: {
+        // ڵ߱ĴҿԽõֵڵǰ桢úָ
+        std::vector<std::pair<Reg, int>> saved;
+        auto it = alloc.savedAroundCall.find(inst);
+        if (it != alloc.savedAroundCall.end()) {
+            for (auto* v : it->second) {
+                saved.emplace_back(alloc.regs.at(v), spillBase + alloc.saveSlots.at(v) * 4);
+                emitMem(MOp::Sw, saved.back().first, saved.back().second);
+            }
+        }
+
+        std::vector<Move> moves;
+        for (size_t i = 0; i < inst->operands.size(); ++i) {
+            Location dst;
+            if (i < 8) dst.reg = argReg(i);
+            else dst = stackArgLocation(i, false);
+            moves.push_back({ dst, locationOf(inst->getOperand(i)) });
+        }
+        genParallelMoves(moves);
+        emit(MachineInstr::call(inst->callee));
+        if (inst->type != IRType::Void) {
+            Location a0;
+            a0.reg = Reg::a0;
+            emitMove(locationOf(inst), a0);
+        }
+        for (auto& [reg, slot] : saved) {
+            emitMem(MOp::Lw, reg, slot);
+        }
+        break;
+    }
+    case Opcode::Br: {
+        BasicBlock* target = inst->blocks[0];
+        genPhiMoves(inst->parent, target);
+        if (inst->parent == restoreBlock) genRestore();
+        if (target != next) {
+            emit(MachineInstr::jump(blockLabel(target)));
+        }
+        break;
+    }
+    case Opcode::CondBr: {
+        // ǽڵıȽʱֱ b<cond> 0 Ƚ
+        Value* cond = inst->getOperand(0);
+        MOp op = MOp::Bne;
+        Reg lhs;
+        Reg rhs = Reg::zero;
+        bool swapped = false;
+        if (isFusedCompare(cond)) {
+            auto* cmp = static_cast<Instruction*>(cond);
+            lhs = loadValue(cmp->getOperand(0), Reg::t0);
+            rhs = loadValue(cmp->getOperand(1), Reg::t1);
+            switch (cmp->op) {
+            case Opcode::Lt: op = MOp::Blt; break;
+            case Opcode::Gt: op = MOp::Blt; swapped = true; break;
+            case Opcode::Le: op = MOp::Bge; swapped = true; break;
+            case Opcode::Ge: op = MOp::Bge; break;
+            case Opcode::Eq: op = MOp::Beq; break;
+            default: break;
+            }
+        }
+        else {
+            lhs = loadValue(cond, Reg::t0);
+        }
+        if (inst->parent == restoreBlock) {
+            // ڼָ s Ĵ
+            for (auto* reg : { &lhs, &rhs }) {
+                if (!isCalleeSaved(*reg)) continue;
+                Reg scratch = reg == &lhs ? Reg::t0 : Reg::t1;
+                emit(MachineInstr::unary(MOp::Mv, scratch, *reg));
+                *reg = scratch;
+            }
+            genRestore();
+        }
+        if (swapped) std::swap(lhs, rhs);
+        BasicBlock* trueBB = inst->blocks[0];
+        BasicBlock* falseBB = inst->blocks[1];
+        if (trueBB == next) {
+            emit(branchInst(invertBranch(op), lhs, rhs, blockLabel(falseBB)));
+        }
+        else {
+            emit(branchInst(op, lhs, rhs, blockLabel(trueBB)));
+            if (falseBB != next) {
+                emit(MachineInstr::jump(blockLabel(falseBB)));
+            }
+        }
+        break;
+    }
+    case Opcode::Ret:
+        if (!inst->operands.empty()) {
+            Location a0;
+            a0.reg = Reg::a0;
+            emitMove(a0, locationOf(inst->getOperand(0)));
+        }
+        if (inst->parent == restoreBlock) {
+            genEpilogue();
+        }
+        else if (epilogueLabel.empty()) {
+            emit(MachineInstr::ret());
+        }
+        else if (next) {
+            emit(MachineInstr::jump(epilogueLabel));
+        }
+        break;
+    default: {
+        if (genImmediate(inst)) break;
+        Reg lhs = loadValue(inst->getOperand(0), Reg::t0);
+        Reg rhs = loadValue(inst->getOperand(1), Reg::t1);
+        Reg dst = destReg(inst, Reg::t0);
 
-    if (auto decl = std::dynamic_pointer_cast<DeclareStmt>(stmt)) {
-        allocVar(decl->varName);
-        std::string reg = genExprToReg(decl->initVal);
-        emit("sw " + reg + ", " + std::to_string(varOffsets[decl->varName]) + "(sp)");
+        switch (inst->op) {
+        case Opcode::Add: emit(MachineInstr::rr(MOp::Add, dst, lhs, rhs)); break;
+        case Opcode::Sub: emit(MachineInstr::rr(MOp::Sub, dst, lhs, rhs)); break;
+        case Opcode::Mul: emit(MachineInstr::rr(MOp::Mul, dst, lhs, rhs)); break;
+        case Opcode::Div: emit(MachineInstr::rr(MOp::Div, dst, lhs, rhs)); break;
+        case Opcode::Rem: emit(MachineInstr::rr(MOp::Rem, dst, lhs, rhs)); break;
+        case Opcode::Shl: emit(MachineInstr::rr(MOp::Sll, dst, lhs, rhs)); break;
+        case Opcode::Lt: emit(MachineInstr::rr(MOp::Slt, dst, lhs, rhs)); break;
+        case Opcode::Gt: emit(MachineInstr::rr(MOp::Slt, dst, rhs, lhs)); break;
+        case Opcode::Eq:
+            emit(MachineInstr::rr(MOp::Sub, dst, lhs, rhs));
+            emit(MachineInstr::unary(MOp::Seqz, dst, dst));
+            break;
+        case Opcode::Ne:
+            emit(MachineInstr::rr(MOp::Sub, dst, lhs, rhs));
+            emit(MachineInstr::unary(MOp::Snez, dst, dst));
+            break;
+        case Opcode::Le:
+            emit(MachineInstr::rr(MOp::Slt, dst, rhs, lhs));
+            emit(MachineInstr::ri(MOp::Xori, dst, dst, 1));
+            break;
+        case Opcode::Ge:
+            emit(MachineInstr::rr(MOp::Slt, dst, lhs, rhs));
+            emit(MachineInstr::ri(MOp::Xori, dst, dst, 1));
+            break;
+        default:
+            throw std::runtime_error(std::string("Unsupported IR instruction: ") + opcodeName(inst->op));
+        }
+        storeValue(inst, dst);
+        break;
     }
-    else if (auto assign = std::dynamic_pointer_cast<AssignStmt>(stmt)) {
-        std::string reg = genExprToReg(assign->value);
-        emit("sw " + reg + ", " + std::to_string(varOffsets[assign->varName]) + "(sp)");
     }
-    else if (auto ret = std::dynamic_pointer_cast<ReturnStmt>(stmt)) {
-        if (ret->value) {
-            std::string reg = genExprToReg(ret->value);
-            emit("mv a0, " + reg);
+}
+
+// һΪĶԪѡ I ָ (addi/slti/slli/srai/andi/xori)  neg/seqz/snezʡȥװس
+// ʱȰɻתȽϷ򻻵Ҳࡣʱ falseɵ R ָ
+bool CodeGen::genImmediate(Instruction* inst) {
+    Opcode op = inst->op;
+    Value* x = inst->getOperand(0);
+    Value* y = inst->getOperand(1);
+    if (x->isConstant() && !y->isConstant()) {
+        switch (op) {
+        case Opcode::Add: case Opcode::Mul: case Opcode::Eq: case Opcode::Ne: break;
+        case Opcode::Lt: op = Opcode::Gt; break;
+        case Opcode::Gt: op = Opcode::Lt; break;
+        case Opcode::Le: op = Opcode::Ge; break;
+        case Opcode::Ge: op = Opcode::Le; break;
+        case Opcode::Sub:
+            if (static_cast<Constant*>(x)->value != 0) return false;
+            storeValue(inst, emitUnary(MOp::Neg, inst, y));
+            return true;
+        default: return false;
         }
+        std::swap(x, y);
     }
-    else if (auto block = std::dynamic_pointer_cast<BlockStmt>(stmt)) {
-        genBlock(block);
+    if (!y->isConstant()) return false;
+    int c = static_cast<Constant*>(y)->value;
+    if (c == INT32_MIN) return false;   // ȡ
+    int shift = 0;
+    while (shift < 31 && (1 << shift) < c) ++shift;
+    bool powerOfTwo = c > 1 && (1 << shift) == c;
+
+    Reg src = Reg::None;
+    Reg dst = Reg::None;
+    auto begin = [&]() {
+        src = loadValue(x, Reg::t0);
+        dst = destReg(inst, Reg::t0);
+    };
+    auto emitI = [&](MOp name, Reg rd, Reg rs, int imm) {
+        emit(MachineInstr::ri(name, rd, rs, imm));
+    };
+    // Ӽ 0˳ 1λ 0 ֻǿ
+    bool identity = ((op == Opcode::Add || op == Opcode::Sub || op == Opcode::Shl) && c == 0)
+        || ((op == Opcode::Mul || op == Opcode::Div) && c == 1);
+    if (identity) {
+        begin();
+        storeValue(inst, src);
+        return true;
     }
-    else if (auto exprstmt = std::dynamic_pointer_cast<ExprStmt>(stmt)) {
-        genExprToReg(exprstmt->expr);
+    switch (op) {
+    case Opcode::Add:
+    case Opcode::Sub: {
+        int imm = op == Opcode::Add ? c : -c;
+        if (!fitsImm12(imm)) return false;
+        begin();
+        emitI(MOp::Addi, dst, src, imm);
+        break;
     }
-    else if (auto ifstmt = std::dynamic_pointer_cast<IfStmt>(stmt)) {
-        std::string cond = genExprToReg(ifstmt->condition);
-        std::string l_else = newLabel("else");
-        std::string l_end = newLabel("endif");
-        emit("beqz " + cond + ", " + l_else);
-        genStmt(ifstmt->thenStmt);
-        emit("j " + l_end);
-        emit(l_else + ":");
-        if (ifstmt->elseStmt) {
-            genStmt(ifstmt->elseStmt);
+    case Opcode::Mul:
+        if (c == -1) {
+            storeValue(inst, emitUnary(MOp::Neg, inst, x));
+            return true;
+        }
+        if (!powerOfTwo) return false;
+        begin();
+        emitI(MOp::Slli, dst, src, shift);
+        break;
+    case Opcode::Shl:
+        begin();
+        emitI(MOp::Slli, dst, src, c & 31);
+        break;
+    case Opcode::Div:
+    case Opcode::Rem:
+        // зų 2^k ȡȼ 2^k-1 (ɷλƵõ) ƣ
+        // Ϊ x ȥ䰴ͬʽضϵ 2^k Ľ
+        if (!powerOfTwo || (op == Opcode::Rem && !fitsImm12(-c))) return false;
+        begin();
+        if (shift == 1) {
+            emitI(MOp::Srli, Reg::t1, src, 31);
+        }
+        else {
+            emitI(MOp::Srai, Reg::t1, src, 31);
+            emitI(MOp::Srli, Reg::t1, Reg::t1, 32 - shift);
+        }
+        emit(MachineInstr::rr(MOp::Add, Reg::t1, src, Reg::t1));
+        if (op == Opcode::Div) {
+            emitI(MOp::Srai, dst, Reg::t1, shift);
         }
-        emit(l_end + ":");
+        else {
+            emitI(MOp::Andi, Reg::t1, Reg::t1, -c);
+            emit(MachineInstr::rr(MOp::Sub, dst, src, Reg::t1));
+        }
+        break;
+    case Opcode::Lt:
+        if (!fitsImm12(c)) return false;
+        begin();
+        emitI(MOp::Slti, dst, src, c);
+        break;
+    case Opcode::Le:
+        // x <= c  x < c + 1ų c == INT32_MAX c + 1 
+        if (c == INT32_MAX || !fitsImm12(c + 1)) return false;
+        begin();
+        emitI(MOp::Slti, dst, src, c + 1);
+        break;
+    case Opcode::Ge:
+        if (!fitsImm12(c)) return false;
+        begin();
+        emitI(MOp::Slti, dst, src, c);
+        emitI(MOp::Xori, dst, dst, 1);
+        break;
+    case Opcode::Eq:
+    case Opcode::Ne: {
+        // seqz  sltiu rd, rs, 1
+        MOp test = op == Opcode::Eq ? MOp::Seqz : MOp::Snez;
+        if (c == 0) {
+            storeValue(inst, emitUnary(test, inst, x));
+            return true;
+        }
+        if (!fitsImm12(-c)) return false;
+        begin();
+        emitI(MOp::Addi, dst, src, -c);
+        emit(MachineInstr::unary(test, dst, dst));
+        break;
+    }
+    default:
+        return false;
+    }
+    storeValue(inst, dst);
+    return true;
+}
+
+Reg CodeGen::emitUnary(MOp op, Instruction* inst, Value* operand) {
+    Reg src = loadValue(operand, Reg::t0);
+    Reg dst = destReg(inst, Reg::t0);
+    emit(MachineInstr::unary(op, dst, src));
+    return dst;
+}
+
+void CodeGen::genPhiMoves(BasicBlock* from, BasicBlock* to) {
+    std::vector<Move> moves;
+    for (auto& inst : to->insts) {
+        if (!inst->isPhi()) break;
+        moves.push_back({ locationOf(inst.get()), locationOf(inst->getIncomingValue(from)) });
     }
-    else if (auto whilestmt = std::dynamic_pointer_cast<WhileStmt>(stmt)) {
-        std::string l_begin = newLabel("loop");
-        std::string l_end = newLabel("endloop");
+    genParallelMoves(moves);
+}
 
-        // ȷǩѹջɴǰ
-        continueLabels.push_back(l_begin);
-        breakLabels.push_back(l_end);
+// пĿλԱȡƳ٣ֻʱ t1 ݴһĿľֵ
+void CodeGen::genParallelMoves(std::vector<Move> moves) {
+    moves.erase(std::remove_if(moves.begin(), moves.end(),
+        [](const Move& m) { return m.dst == m.src; }), moves.end());
 
-        emit(l_begin + ":");
-        std::string cond = genExprToReg(whilestmt->condition);
-        emit("beqz " + cond + ", " + l_end);
-        genStmt(whilestmt->body);
-        emit("j " + l_begin);
-        emit(l_end + ":");
+    while (!moves.empty()) {
+        bool progress = false;
+        for (size_t i = 0; i < moves.size(); ++i) {
+            bool blocked = false;
+            for (size_t j = 0; j < moves.size(); ++j) {
+                if (j != i && moves[j].src == moves[i].dst) {
+                    blocked = true;
+                    break;
+                }
+            }
+            if (blocked) continue;
+            emitMove(moves[i].dst, moves[i].src);
+            moves.erase(moves.begin() + i);
+            progress = true;
+            break;
+        }
+        if (progress) continue;
 
-        // ȷǩѭ󵯳
-        continueLabels.pop_back();
-        breakLabels.pop_back();
+        Location saved = moves.front().dst;
+        Location scratch;
+        scratch.reg = Reg::t1;
+        emitMove(scratch, saved);
+        for (auto& m : moves) {
+            if (m.src == saved) m.src = scratch;
+        }
     }
-    else if (auto brk = std::dynamic_pointer_cast<BreakStmt>(stmt)) {
-        if (breakLabels.empty()) throw std::runtime_error("break outside loop");
-        emit("j " + breakLabels.back());
+}
+
+CodeGen::Location CodeGen::locationOf(Value* v) const {
+    Location loc;
+    if (auto* c = dynamic_cast<Constant*>(v)) {
+        loc.isConst = true;
+        loc.value = c->value;
+        return loc;
     }
-    else if (auto cont = std::dynamic_pointer_cast<ContinueStmt>(stmt)) {
-        if (continueLabels.empty()) throw std::runtime_error("continue outside loop");
-        emit("j " + continueLabels.back());
+    auto it = alloc.regs.find(v);
+    if (it != alloc.regs.end()) {
+        loc.reg = it->second;
     }
     else {
-        throw std::runtime_error("Unknown statement");
+        loc.offset = spillBase + alloc.spillSlots.at(v) * 4;
     }
+    return loc;
 }
 
-std::string CodeGen::genExprToReg(const std::shared_ptr<Expr>& expr) {
-    static int regCount = 0;
-    std::string reg = "t" + std::to_string(regCount++ % 7);
-    genExpr(expr, reg);
-    return reg;
+//  index (>= 8) ջλãʱλڱ֡ײʱλڵ֡ײ
+CodeGen::Location CodeGen::stackArgLocation(size_t index, bool incoming) const {
+    Location loc;
+    loc.offset = static_cast<int>(index - 8) * 4 + (incoming ? frameSize : 0);
+    return loc;
 }
 
-void CodeGen::genExpr(const std::shared_ptr<Expr>& expr, const std::string& dst) {
-    if (auto num = std::dynamic_pointer_cast<NumberExpr>(expr)) {
-        emit("li " + dst + ", " + std::to_string(num->value));
+// ռ÷ļĴÿʹʱ (0 ֱ zero)
+Reg CodeGen::loadValue(Value* v, Reg scratch) {
+    Location loc = locationOf(v);
+    if (loc.isConst) {
+        if (loc.value == 0) return Reg::zero;
+        emitLoadImm(scratch, loc.value);
+        return scratch;
     }
-    else if (auto var = std::dynamic_pointer_cast<VariableExpr>(expr)) {
-        emit("lw " + dst + ", " + std::to_string(varOffsets[var->name]) + "(sp)");
+    if (loc.reg != Reg::None) return loc.reg;
+    emitMem(MOp::Lw, scratch, loc.offset);
+    return scratch;
+}
+
+Reg CodeGen::destReg(const Value* v, Reg scratch) const {
+    auto it = alloc.regs.find(v);
+    return it != alloc.regs.end() ? it->second : scratch;
+}
+
+void CodeGen::storeValue(const Value* v, Reg reg) {
+    auto it = alloc.regs.find(v);
+    if (it == alloc.regs.end()) {
+        emitMem(MOp::Sw, reg, spillBase + alloc.spillSlots.at(v) * 4);
     }
-    else if (auto call = std::dynamic_pointer_cast<CallExpr>(expr)) {
-        for (size_t i = 0; i < call->args.size(); ++i) {
-            std::string argReg = genExprToReg(call->args[i]);
-            emit("mv a" + std::to_string(i) + ", " + argReg);
-        }
-        emit("call " + call->callee);
-        emit("mv " + dst + ", a0");
+    else if (it->second != reg) {
+        emit(MachineInstr::unary(MOp::Mv, it->second, reg));
     }
-    else if (auto bin = std::dynamic_pointer_cast<BinaryExpr>(expr)) {
-        std::string lhs = genExprToReg(bin->lhs);
-        std::string rhs = genExprToReg(bin->rhs);
-        std::string op = bin->op;
+}
 
-        if (op == "+") emit("add " + dst + ", " + lhs + ", " + rhs);
-        else if (op == "-") emit("sub " + dst + ", " + lhs + ", " + rhs);
-        else if (op == "*") emit("mul " + dst + ", " + lhs + ", " + rhs);
-        else if (op == "/") emit("div " + dst + ", " + lhs + ", " + rhs);
-        else if (op == "%") emit("rem " + dst + ", " + lhs + ", " + rhs);
-        else if (op == "<") emit("slt " + dst + ", " + lhs + ", " + rhs);
-        else if (op == ">") emit("slt " + dst + ", " + rhs + ", " + lhs);
-        else if (op == "==") {
-            emit("sub " + dst + ", " + lhs + ", " + rhs);
-            emit("seqz " + dst + ", " + dst);
-        }
-        else if (op == "!=") {
-            emit("sub " + dst + ", " + lhs + ", " + rhs);
-            emit("snez " + dst + ", " + dst);
+void CodeGen::emitMove(const Location& dst, const Location& src) {
+    if (dst == src) return;
+    if (dst.reg != Reg::None) {
+        if (src.isConst) {
+            emitLoadImm(dst.reg, src.value);
         }
-        else if (op == "<=") {
-            emit("slt " + dst + ", " + rhs + ", " + lhs);
-            emit("xori " + dst + ", " + dst + ", 1");
-        }
-        else if (op == ">=") {
-            emit("slt " + dst + ", " + lhs + ", " + rhs);
-            emit("xori " + dst + ", " + dst + ", 1");
+        else if (src.reg != Reg::None) {
+            emit(MachineInstr::unary(MOp::Mv, dst.reg, src.reg));
         }
         else {
-            throw std::runtime_error("Unsupported binary operator: " + op);
+            emitMem(MOp::Lw, dst.reg, src.offset);
         }
+        return;
+    }
+    Reg reg;
+    if (src.isConst) {
+        reg = src.value == 0 ? Reg::zero : Reg::t0;
+        if (src.value != 0) emitLoadImm(Reg::t0, src.value);
+    }
+    else if (src.reg != Reg::None) {
+        reg = src.reg;
     }
     else {
-        throw std::runtime_error("Unsupported expression type");
+        emitMem(MOp::Lw, Reg::t0, src.offset);
+        reg = Reg::t0;
+    }
+    emitMem(MOp::Sw, reg, dst.offset);
+}
+
+// 12 λڵĳ li ( addi rd, zero, imm) lui װ 20 λ addi  12 λ
+//  12 λзϣλȼ 0x800 λ
+void CodeGen::emitLoadImm(Reg reg, int value) {
+    if (fitsImm12(value)) {
+        emit(MachineInstr::li(reg, value));
+        return;
     }
-}
\ No newline at end of file
+    uint32_t bits = static_cast<uint32_t>(value);
+    uint32_t hi = ((bits + 0x800) >> 12) & 0xfffff;
+    int lo = static_cast<int>(bits - (hi << 12));
+    emit(MachineInstr::ri(MOp::Lui, reg, Reg::None, static_cast<int>(hi)));
+    if (lo != 0) emit(MachineInstr::ri(MOp::Addi, reg, reg, lo));
+}
+
+// ջ۷ʣop Ϊ lw  sw
+void CodeGen::emitMem(MOp op, Reg reg, int offset) {
+    Reg base = Reg::sp;
+    if (!fitsImm12(offset)) {
+        //  12 λʱ t2 ַ
+        emitLoadImm(Reg::t2, offset);
+        emit(MachineInstr::rr(MOp::Add, Reg::t2, Reg::t2, Reg::sp));
+        base = Reg::t2;
+        offset = 0;
+    }
+    emit(op == MOp::Lw ? MachineInstr::load(reg, offset, base) : MachineInstr::store(reg, offset, base));
+}
+
+void CodeGen::adjustSp(int delta) {
+    if (delta == 0) return;
+    if (fitsImm12(delta)) {
+        emit(MachineInstr::ri(MOp::Addi, Reg::sp, Reg::sp, delta));
+    }
+    else {
+        emitLoadImm(Reg::t2, delta);
+        emit(MachineInstr::rr(MOp::Add, Reg::sp, Reg::sp, Reg::t2));
+    }
+}
@@ -1,34 +1,105 @@
 #pragma once
-#include "ast.h"
+#include "ir.h"
+#include "regalloc.h"
+#include "peephole.h"
+#include "machine.h"
+#include "simulator.h"
 #include <string>
+#include <string_view>
 #include <memory>
 #include <vector>
 #include <unordered_map>
+#include <unordered_set>
 #include <ostream>
 
 class CodeGen {
 public:
-    explicit CodeGen(std::ostream& out);
-    void generate(const std::vector<std::shared_ptr<FuncDef>>& funcs);
+    // ɴеָô뿽ںָѡĴЧ
+    struct Stats {
+        int instructions = 0;
+        int loads = 0;
+        int stores = 0;
+        int moves = 0;
+        int spilledValues = 0;
+        // ջ֡Ҫջ۵ֵ (ֵõ㱣ֵ) úĲԼǰ֡С
+        int stackValues = 0;
+        int stackSlots = 0;
+        int frameSize = 0;
+        int unsharedFrameSize = 0;
+    };
+
+    // layout Ϊ true ʱ̬֧Ż鲢ѭͷ
+    explicit CodeGen(std::ostream& out, RegAllocKind allocKind = RegAllocKind::LinearScan, bool runPeephole = true,
+        bool layout = true);
+    void generate(Module& module);
+
+    const Stats& totalStats() const { return total; }
+    const std::vector<std::pair<std::string, Stats>>& functionStats() const { return perFunction; }
+    const PeepholeOptimizer& peepholeStats() const { return peephole; }
+    size_t bytesWritten() const { return writer.bytesWritten(); }
+    // ɵÿ (Ż) ͬʱװ sim --run ִ
+    void setSimulator(Simulator* sim) { simulator = sim; }
 
 private:
-    std::ostream& out;
-    int labelCount = 0;
-    int stackOffset = 0;
-    std::unordered_map<std::string, int> varOffsets;
-    std::vector<std::string> breakLabels;
-    std::vector<std::string> continueLabels;
-
-    void emit(const std::string& line);
-    void genFunc(const std::shared_ptr<FuncDef>& func);
-    //void genOtherFuncs(const std::vector<std::shared_ptr<FuncDef>>& funcs); // 
-    void genStmt(const std::shared_ptr<Stmt>& stmt);
-    void genExpr(const std::shared_ptr<Expr>& expr, const std::string& dst);
-
-    void genBlock(const std::shared_ptr<BlockStmt>& block);
-    std::string genExprToReg(const std::shared_ptr<Expr>& expr);
-    std::string newLabel(const std::string& base);
-
-    void resetStack();
-    void allocVar(const std::string& name);
+    // ֵλãĴջ (sp ƫ)
+    struct Location {
+        Reg reg = Reg::None;   // None ʾջ
+        int offset = 0;
+        bool isConst = false;
+        int value = 0;
+
+        bool operator==(const Location& o) const {
+            if (isConst || o.isConst) return false;
+            return reg == o.reg && (reg != Reg::None || offset == o.offset);
+        }
+    };
+    struct Move {
+        Location dst;
+        Location src;
+    };
+
+    AsmWriter writer;
+    AsmPrinter printer;
+    RegAllocKind allocKind;
+    bool runPeephole;
+    bool layout;
+    PeepholeOptimizer peephole;
+    Simulator* simulator = nullptr;
+    std::unordered_set<const BasicBlock*> alignedBlocks;
+    MachineFunction mfunc;   // ǰɵĻָʱŻ
+    int frameSize = 0;
+    int spillBase = 0;        // ʼƫƣΪջϲ
+    std::string epilogueLabel;   //  ret õβջ֡װʱΪ (ֱ ret)
+    BasicBlock* saveBlock = nullptr;      // ջ֡Ŀ
+    BasicBlock* restoreBlock = nullptr;   // װʱջ֡Ŀ飬Ϊ
+    Allocation alloc;
+    std::vector<std::pair<Reg, int>> savedRegs;   // ߱Ĵ ra -> 
+    Stats stats;
+    Stats total;
+    std::vector<std::pair<std::string, Stats>> perFunction;
+
+    void emit(const MachineInstr& mi);
+    void flush();
+    void genFunc(Function& func);
+    void genBlock(BasicBlock* bb, BasicBlock* next);
+    void genInst(Instruction* inst, BasicBlock* next);
+    bool genImmediate(Instruction* inst);
+    Reg emitUnary(MOp op, Instruction* inst, Value* operand);
+    void genPhiMoves(BasicBlock* from, BasicBlock* to);
+    void genParallelMoves(std::vector<Move> moves);
+    void genPrologue();
+    void genRestore();
+    void genEpilogue();
+    std::vector<BasicBlock*> frameBlocks(Function& func) const;
+
+    Location locationOf(Value* v) const;
+    Location stackArgLocation(size_t index, bool incoming) const;
+    Reg loadValue(Value* v, Reg scratch);
+    Reg destReg(const Value* v, Reg scratch) const;
+    void storeValue(const Value* v, Reg reg);
+    void emitMove(const Location& dst, const Location& src);
+    void emitLoadImm(Reg reg, int value);
+    void emitMem(MOp op, Reg reg, int offset);
+    void adjustSp(int delta);
+    std::string_view blockLabel(const BasicBlock* bb) const;
 };
@@ -0,0 +1,419 @@
+#pragma once
+#include "ir.h"
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// 稠密位向量：按 64 位字存储，适合全集较小或集合较满的问题
+class BitVector {
+public:
+    BitVector() = default;
+    explicit BitVector(size_t n, bool value = false)
+        : words((n + 63) / 64, value ? ~0ULL : 0ULL), bits(n) {
+        clearTail();
+    }
+
+    size_t size() const { return bits; }
+    bool test(size_t i) const { return (words[i >> 6] >> (i & 63)) & 1; }
+    void set(size_t i) { words[i >> 6] |= 1ULL << (i & 63); }
+    void reset(size_t i) { words[i >> 6] &= ~(1ULL << (i & 63)); }
+
+    bool unionWith(const BitVector& o) {
+        bool changed = false;
+        for (size_t i = 0; i < words.size(); ++i) {
+            uint64_t w = words[i] | o.words[i];
+            changed |= w != words[i];
+            words[i] = w;
+        }
+        return changed;
+    }
+
+    bool intersectWith(const BitVector& o) {
+        bool changed = false;
+        for (size_t i = 0; i < words.size(); ++i) {
+            uint64_t w = words[i] & o.words[i];
+            changed |= w != words[i];
+            words[i] = w;
+        }
+        return changed;
+    }
+
+    void subtract(const BitVector& o) {
+        for (size_t i = 0; i < words.size(); ++i) {
+            words[i] &= ~o.words[i];
+        }
+    }
+
+    bool operator==(const BitVector& o) const { return words == o.words; }
+    bool operator!=(const BitVector& o) const { return words != o.words; }
+
+    size_t count() const {
+        size_t n = 0;
+        for (uint64_t w : words) {
+            for (; w; w &= w - 1) ++n;
+        }
+        return n;
+    }
+
+    template <typename F>
+    void forEach(F f) const {
+        for (size_t i = 0; i < words.size(); ++i) {
+            for (uint64_t w = words[i]; w; w &= w - 1) {
+                f(i * 64 + countTrailingZeros(w));
+            }
+        }
+    }
+
+private:
+    std::vector<uint64_t> words;
+    size_t bits = 0;
+
+    void clearTail() {
+        if (bits % 64 && !words.empty()) words.back() &= (1ULL << (bits % 64)) - 1;
+    }
+
+    static size_t countTrailingZeros(uint64_t w) {
+        size_t n = 0;
+        while (!(w & 1)) {
+            w >>= 1;
+            ++n;
+        }
+        return n;
+    }
+};
+
+// 稀疏位向量：只保存非零的 64 位字 (按字下标有序)，适合全集很大但集合稀疏的问题，
+// 例如上千个块的函数中每块只有少量活跃值
+class SparseBitVector {
+public:
+    SparseBitVector() = default;
+    explicit SparseBitVector(size_t n, bool value = false) : bits(n) {
+        if (value) {
+            for (size_t i = 0; i < (n + 63) / 64; ++i) {
+                uint64_t w = ~0ULL;
+                if (i == n / 64 && n % 64) w = (1ULL << (n % 64)) - 1;
+                chunks.emplace_back(static_cast<uint32_t>(i), w);
+            }
+        }
+    }
+
+    size_t size() const { return bits; }
+
+    bool test(size_t i) const {
+        auto it = lower(static_cast<uint32_t>(i >> 6));
+        return it != chunks.end() && it->first == (i >> 6) && ((it->second >> (i & 63)) & 1);
+    }
+
+    void set(size_t i) {
+        uint32_t key = static_cast<uint32_t>(i >> 6);
+        auto it = lower(key);
+        if (it == chunks.end() || it->first != key) it = chunks.insert(it, { key, 0 });
+        it->second |= 1ULL << (i & 63);
+    }
+
+    void reset(size_t i) {
+        uint32_t key = static_cast<uint32_t>(i >> 6);
+        auto it = lower(key);
+        if (it == chunks.end() || it->first != key) return;
+        it->second &= ~(1ULL << (i & 63));
+        if (!it->second) chunks.erase(it);
+    }
+
+    bool unionWith(const SparseBitVector& o) {
+        if (o.chunks.empty()) return false;
+        std::vector<std::pair<uint32_t, uint64_t>> merged;
+        merged.reserve(chunks.size() + o.chunks.size());
+        bool changed = false;
+        size_t i = 0, j = 0;
+        while (i < chunks.size() || j < o.chunks.size()) {
+            if (j == o.chunks.size() || (i < chunks.size() && chunks[i].first < o.chunks[j].first)) {
+                merged.push_back(chunks[i++]);
+            }
+            else if (i == chunks.size() || o.chunks[j].first < chunks[i].first) {
+                merged.push_back(o.chunks[j++]);
+                changed = true;
+            }
+            else {
+                uint64_t w = chunks[i].second | o.chunks[j].second;
+                changed |= w != chunks[i].second;
+                merged.emplace_back(chunks[i].first, w);
+                ++i;
+                ++j;
+            }
+        }
+        if (changed) chunks.swap(merged);
+        return changed;
+    }
+
+    bool intersectWith(const SparseBitVector& o) {
+        std::vector<std::pair<uint32_t, uint64_t>> result;
+        bool changed = false;
+        size_t j = 0;
+        for (auto& [key, word] : chunks) {
+            while (j < o.chunks.size() && o.chunks[j].first < key) ++j;
+            uint64_t w = (j < o.chunks.size() && o.chunks[j].first == key) ? word & o.chunks[j].second : 0;
+            changed |= w != word;
+            if (w) result.emplace_back(key, w);
+        }
+        if (changed) chunks.swap(result);
+        return changed;
+    }
+
+    void subtract(const SparseBitVector& o) {
+        size_t j = 0, out = 0;
+        for (size_t i = 0; i < chunks.size(); ++i) {
+            while (j < o.chunks.size() && o.chunks[j].first < chunks[i].first) ++j;
+            uint64_t w = chunks[i].second;
+            if (j < o.chunks.size() && o.chunks[j].first == chunks[i].first) w &= ~o.chunks[j].second;
+            if (w) chunks[out++] = { chunks[i].first, w };
+        }
+        chunks.resize(out);
+    }
+
+    bool operator==(const SparseBitVector& o) const { return chunks == o.chunks; }
+    bool operator!=(const SparseBitVector& o) const { return chunks != o.chunks; }
+
+    size_t count() const {
+        size_t n = 0;
+        for (auto& c : chunks) {
+            for (uint64_t w = c.second; w; w &= w - 1) ++n;
+        }
+        return n;
+    }
+
+    template <typename F>
+    void forEach(F f) const {
+        for (auto& [key, word] : chunks) {
+            for (uint64_t w = word; w; w &= w - 1) {
+                size_t bit = 0;
+                while (!((w >> bit) & 1)) ++bit;
+                f(static_cast<size_t>(key) * 64 + bit);
+            }
+        }
+    }
+
+private:
+    std::vector<std::pair<uint32_t, uint64_t>> chunks;
+    size_t bits = 0;
+
+    std::vector<std::pair<uint32_t, uint64_t>>::iterator lower(uint32_t key) {
+        return std::lower_bound(chunks.begin(), chunks.end(), key,
+            [](const std::pair<uint32_t, uint64_t>& c, uint32_t k) { return c.first < k; });
+    }
+    std::vector<std::pair<uint32_t, uint64_t>>::const_iterator lower(uint32_t key) const {
+        return std::lower_bound(chunks.begin(), chunks.end(), key,
+            [](const std::pair<uint32_t, uint64_t>& c, uint32_t k) { return c.first < k; });
+    }
+};
+
+enum class Direction { Forward, Backward };
+enum class Meet { Union, Intersection };
+
+// 通用位向量数据流求解器。Problem 需提供:
+//   using Set;  static constexpr Direction direction;  static constexpr Meet meet;
+//   Set boundary() const;   入口 (前向) / 无后继块出口 (后向) 的值
+//   Set top() const;        其余块的初始值 (并集问题为空集，交集问题为全集)
+//   void transfer(int block, const BasicBlock* bb, const Set& input, Set& output) const;
+//   void edge(const BasicBlock* from, const BasicBlock* to, Set& value) const;  沿边修正 (如 phi)
+// 前向问题按逆后序、后向问题按后序访问块，用按序号排队的工作表迭代到不动点。
+template <typename Problem>
+class DataflowSolver {
+public:
+    using Set = typename Problem::Set;
+
+    DataflowSolver(Function& func, const Problem& problem) : problem(problem) {
+        computeOrder(func);
+    }
+
+    void solve() {
+        size_t n = blocks.size();
+        in.assign(n, problem.top());
+        out.assign(n, problem.top());
+        std::vector<bool> queued(n, true);
+        std::priority_queue<int, std::vector<int>, std::greater<int>> worklist;
+        for (size_t i = 0; i < n; ++i) worklist.push(static_cast<int>(i));
+
+        constexpr bool forward = Problem::direction == Direction::Forward;
+        while (!worklist.empty()) {
+            int pos = worklist.top();
+            worklist.pop();
+            queued[pos] = false;
+            ++visits;
+
+            int b = order[pos];
+            const BasicBlock* bb = blocks[b];
+            // 汇合：前向取前驱出口，后向取后继入口
+            Set& meetValue = forward ? in[b] : out[b];
+            const auto& sources = forward ? preds[b] : succs[b];
+            if (sources.empty()) {
+                meetValue = problem.boundary();
+            }
+            else {
+                bool first = true;
+                for (int s : sources) {
+                    Set value = forward ? out[s] : in[s];
+                    if (forward) problem.edge(blocks[s], bb, value);
+                    else problem.edge(bb, blocks[s], value);
+                    if (first) {
+                        meetValue = std::move(value);
+                        first = false;
+                    }
+                    else if (Problem::meet == Meet::Union) {
+                        meetValue.unionWith(value);
+                    }
+                    else {
+                        meetValue.intersectWith(value);
+                    }
+                }
+            }
+
+            Set result;
+            problem.transfer(b, bb, meetValue, result);
+            Set& target = forward ? out[b] : in[b];
+            if (result != target) {
+                target = std::move(result);
+                for (int d : (forward ? succs[b] : preds[b])) {
+                    if (!queued[position[d]]) {
+                        queued[position[d]] = true;
+                        worklist.push(position[d]);
+                    }
+                }
+            }
+        }
+    }
+
+    int blockIndex(const BasicBlock* bb) const {
+        auto it = index.find(bb);
+        return it == index.end() ? -1 : it->second;
+    }
+    size_t numBlocks() const { return blocks.size(); }
+    const BasicBlock* block(int i) const { return blocks[i]; }
+
+    // 块入口/出口处的值 (与方向无关，均按程序顺序)
+    const Set& blockIn(const BasicBlock* bb) const { return in[blockIndex(bb)]; }
+    const Set& blockOut(const BasicBlock* bb) const { return out[blockIndex(bb)]; }
+
+    long long visits = 0;   // 传递函数被调用的次数
+
+private:
+    const Problem& problem;
+    std::vector<const BasicBlock*> blocks;          // 按逆后序编号的可达块
+    std::unordered_map<const BasicBlock*, int> index;
+    std::vector<std::vector<int>> preds, succs;
+    std::vector<int> order;       // 访问顺序中第 k 个块
+    std::vector<int> position;    // 块在访问顺序中的位置
+    std::vector<Set> in, out;
+
+    void computeOrder(Function& func) {
+        std::vector<const BasicBlock*> postorder;
+        std::unordered_map<const BasicBlock*, bool> visited;
+        std::vector<std::pair<const BasicBlock*, size_t>> stack{ { func.entry(), 0 } };
+        visited[func.entry()] = true;
+        while (!stack.empty()) {
+            auto& [bb, next] = stack.back();
+            auto succList = bb->succs();
+            if (next < succList.size()) {
+                const BasicBlock* succ = succList[next++];
+                if (!visited[succ]) {
+                    visited[succ] = true;
+                    stack.emplace_back(succ, 0);
+                }
+            }
+            else {
+                postorder.push_back(bb);
+                stack.pop_back();
+            }
+        }
+        blocks.assign(postorder.rbegin(), postorder.rend());
+        for (size_t i = 0; i < blocks.size(); ++i) index[blocks[i]] = static_cast<int>(i);
+
+        preds.assign(blocks.size(), {});
+        succs.assign(blocks.size(), {});
+        for (size_t i = 0; i < blocks.size(); ++i) {
+            for (auto* succ : blocks[i]->succs()) {
+                int s = index[succ];
+                if (std::find(succs[i].begin(), succs[i].end(), s) != succs[i].end()) continue;
+                succs[i].push_back(s);
+                preds[s].push_back(static_cast<int>(i));
+            }
+        }
+
+        order.resize(blocks.size());
+        position.resize(blocks.size());
+        for (size_t k = 0; k < blocks.size(); ++k) {
+            size_t b = Problem::direction == Direction::Forward ? k : blocks.size() - 1 - k;
+            order[k] = static_cast<int>(b);
+            position[b] = static_cast<int>(k);
+        }
+    }
+};
+
+// 活跃变量分析 (后向、并集)。值按 Function::numberValues() 的编号索引，常量不参与。
+// phi 的使用计入对应前驱的出口，phi 的定义位于块入口。
+template <typename SetT = SparseBitVector>
+class LivenessAnalysis {
+public:
+    using Set = SetT;
+
+    explicit LivenessAnalysis(Function& func) : numValues(func.numberValues()) {
+        problem.owner = this;
+        solver = std::make_unique<DataflowSolver<Problem>>(func, problem);
+        size_t n = solver->numBlocks();
+        uses.assign(n, Set(numValues));
+        defs.assign(n, Set(numValues));
+        for (size_t b = 0; b < n; ++b) {
+            for (auto& inst : solver->block(static_cast<int>(b))->insts) {
+                if (!inst->isPhi()) {
+                    for (auto* op : inst->operands) {
+                        if (!op->isConstant() && !defs[b].test(op->id)) uses[b].set(op->id);
+                    }
+                }
+                if (inst->type != IRType::Void) defs[b].set(inst->id);
+            }
+        }
+        solver->solve();
+    }
+
+    const Set& liveIn(const BasicBlock* bb) const { return solver->blockIn(bb); }
+    const Set& liveOut(const BasicBlock* bb) const { return solver->blockOut(bb); }
+    bool isLiveIn(const Value* v, const BasicBlock* bb) const { return liveIn(bb).test(v->id); }
+    bool isLiveOut(const Value* v, const BasicBlock* bb) const { return liveOut(bb).test(v->id); }
+    size_t universe() const { return numValues; }
+    long long visits() const { return solver->visits; }
+
+private:
+    struct Problem {
+        using Set = SetT;
+        static constexpr Direction direction = Direction::Backward;
+        static constexpr Meet meet = Meet::Union;
+        const LivenessAnalysis* owner = nullptr;
+
+        Set boundary() const { return Set(owner->numValues); }
+        Set top() const { return Set(owner->numValues); }
+
+        void transfer(int b, const BasicBlock*, const Set& liveOut, Set& liveIn) const {
+            liveIn = liveOut;
+            liveIn.subtract(owner->defs[b]);
+            liveIn.unionWith(owner->uses[b]);
+        }
+
+        void edge(const BasicBlock* from, const BasicBlock* to, Set& value) const {
+            for (auto& inst : to->insts) {
+                if (!inst->isPhi()) break;
+                Value* v = inst->getIncomingValue(from);
+                if (v && !v->isConstant()) value.set(v->id);
+            }
+        }
+    };
+
+    size_t numValues;
+    Problem problem;
+    std::unique_ptr<DataflowSolver<Problem>> solver;
+    std::vector<Set> uses, defs;
+};
+
+using Liveness = LivenessAnalysis<SparseBitVector>;
@@ -0,0 +1,36 @@
+#include "dce.h"
+#include <unordered_set>
+
+Preserved runDCE(Function& func, DCEStats& stats) {
+    std::unordered_set<const Instruction*> live;
+    std::vector<Instruction*> worklist;
+    for (auto& bb : func.blocks) {
+        for (auto& inst : bb->insts) {
+            if (inst->hasSideEffects() && live.insert(inst.get()).second) worklist.push_back(inst.get());
+        }
+    }
+    while (!worklist.empty()) {
+        Instruction* inst = worklist.back();
+        worklist.pop_back();
+        for (auto* v : inst->operands) {
+            if (!v || !v->isInstruction()) continue;
+            auto* def = static_cast<Instruction*>(v);
+            if (live.insert(def).second) worklist.push_back(def);
+        }
+    }
+
+    // 死指令之间可能互相引用，先全部断开再删除
+    std::vector<Instruction*> dead;
+    for (auto& bb : func.blocks) {
+        for (auto& inst : bb->insts) {
+            if (!live.count(inst.get())) dead.push_back(inst.get());
+        }
+    }
+    for (auto* inst : dead) inst->dropAllOperands();
+    for (auto* inst : dead) {
+        if (inst->isPhi()) ++stats.phis;
+        else ++stats.instructions;
+        inst->parent->erase(inst);
+    }
+    return dead.empty() ? Preserved::All : Preserved::CFG;
+}
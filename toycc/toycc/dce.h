@@ -0,0 +1,13 @@
+#pragma once
+#include "ir.h"
+#include "analysis.h"
+
+struct DCEStats {
+    int instructions = 0;   // 删除的普通指令 (结果无人使用的赋值与运算)
+    int phis = 0;           // 删除的 phi (只在循环中自我传递、出循环后不再被读的变量)
+};
+
+// 死代码删除：以调用与终结指令为根，沿操作数标记所有活跃值，其余指令的结果
+// 不会被任何有副作用的指令读到，全部删除。先标记后清除，因此循环中互相引用的死 phi 也能删掉。
+// 调用即使结果未被使用也保留
+Preserved runDCE(Function& func, DCEStats& stats);
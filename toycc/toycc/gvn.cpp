@@ -0,0 +1,163 @@
+#include "gvn.h"
+#include <functional>
+#include <unordered_map>
+
+namespace {
+
+struct ExprKey {
+    Opcode op;
+    const Value* lhs;
+    const Value* rhs;
+
+    bool operator==(const ExprKey& o) const { return op == o.op && lhs == o.lhs && rhs == o.rhs; }
+};
+
+struct ExprKeyHash {
+    size_t operator()(const ExprKey& k) const {
+        size_t h = std::hash<const Value*>()(k.lhs);
+        h = h * 31 + std::hash<const Value*>()(k.rhs);
+        return h * 31 + static_cast<size_t>(k.op);
+    }
+};
+
+bool isNumberable(const Instruction* inst) {
+    return inst->type != IRType::Void && !inst->isPhi() && !inst->hasSideEffects() && inst->op != Opcode::Copy;
+}
+
+// 交换律运算按操作数地址排序，a > b 写成 b < a，使等价的表达式得到相同的键
+ExprKey keyOf(const Instruction* inst) {
+    Opcode op = inst->op;
+    const Value* a = inst->getOperand(0);
+    const Value* b = inst->operands.size() > 1 ? inst->getOperand(1) : nullptr;
+    switch (op) {
+    case Opcode::Gt: op = Opcode::Lt; std::swap(a, b); break;
+    case Opcode::Ge: op = Opcode::Le; std::swap(a, b); break;
+    case Opcode::Add: case Opcode::Mul: case Opcode::Eq: case Opcode::Ne:
+        if (std::less<const Value*>()(b, a)) std::swap(a, b);
+        break;
+    default: break;
+    }
+    return { op, a, b };
+}
+
+// 各入口 (除自身外) 都是同一个值的 phi
+Value* trivialPhiValue(const Instruction* phi) {
+    Value* same = nullptr;
+    for (auto* v : phi->operands) {
+        if (v == phi || v == same) continue;
+        if (same) return nullptr;
+        same = v;
+    }
+    return same;
+}
+
+bool samePhi(const Instruction* a, const Instruction* b) {
+    if (a->operands.size() != b->operands.size()) return false;
+    for (size_t i = 0; i < a->operands.size(); ++i) {
+        if (b->getIncomingValue(a->blocks[i]) != a->operands[i]) return false;
+    }
+    return true;
+}
+
+class GVN {
+public:
+    GVN(Function& func, AnalysisManager& am, GVNStats& stats) : func(func), dom(am.domTree()), stats(stats) {}
+
+    bool run() {
+        simplifyPhis();
+        // 支配树先序遍历，离开子树时撤销其中加入的表达式
+        std::vector<std::pair<BasicBlock*, size_t>> stack;
+        enter(func.entry());
+        stack.emplace_back(func.entry(), 0);
+        while (!stack.empty()) {
+            auto& [bb, next] = stack.back();
+            const auto& kids = dom.children(bb);
+            if (next < kids.size()) {
+                BasicBlock* child = kids[next++];
+                enter(child);
+                stack.emplace_back(child, 0);
+                continue;
+            }
+            for (auto& key : scopes.back()) available.erase(key);
+            scopes.pop_back();
+            stack.pop_back();
+        }
+        simplifyPhis();
+        return changed;
+    }
+
+private:
+    Function& func;
+    DominatorTree& dom;
+    GVNStats& stats;
+    std::unordered_map<ExprKey, Value*, ExprKeyHash> available;
+    std::vector<std::vector<ExprKey>> scopes;
+    bool changed = false;
+
+    void replace(Instruction* inst, Value* v) {
+        inst->replaceAllUsesWith(v);
+        inst->parent->erase(inst);
+        changed = true;
+    }
+
+    void enter(BasicBlock* bb) {
+        scopes.emplace_back();
+        std::vector<Instruction*> phis;
+        for (auto it = bb->insts.begin(); it != bb->insts.end();) {
+            Instruction* inst = (it++)->get();
+            if (inst->isPhi()) {
+                Instruction* dup = nullptr;
+                for (auto* p : phis) {
+                    if (samePhi(p, inst)) dup = p;
+                }
+                if (dup) {
+                    replace(inst, dup);
+                    ++stats.phis;
+                }
+                else {
+                    phis.push_back(inst);
+                }
+            }
+            else if (inst->op == Opcode::Copy) {
+                replace(inst, inst->getOperand(0));
+                ++stats.copies;
+            }
+            else if (isNumberable(inst)) {
+                ExprKey key = keyOf(inst);
+                auto found = available.find(key);
+                if (found != available.end()) {
+                    replace(inst, found->second);
+                    ++stats.expressions;
+                }
+                else {
+                    available.emplace(key, inst);
+                    scopes.back().push_back(key);
+                }
+            }
+        }
+    }
+
+    // 消去平凡 phi；替换可能使使用它的 phi 也变得平凡，直到不再变化
+    void simplifyPhis() {
+        bool progress = true;
+        while (progress) {
+            progress = false;
+            for (auto& bb : func.blocks) {
+                for (auto it = bb->insts.begin(); it != bb->insts.end() && (*it)->isPhi();) {
+                    Instruction* phi = (it++)->get();
+                    Value* same = trivialPhiValue(phi);
+                    if (!same) continue;
+                    replace(phi, same);
+                    ++stats.phis;
+                    progress = true;
+                }
+            }
+        }
+    }
+};
+
+} // namespace
+
+Preserved runGVN(Function& func, AnalysisManager& am, GVNStats& stats) {
+    return GVN(func, am, stats).run() ? Preserved::CFG : Preserved::All;
+}
@@ -0,0 +1,14 @@
+#pragma once
+#include "ir.h"
+#include "analysis.h"
+
+struct GVNStats {
+    int expressions = 0;   // 被支配者中已算过的表达式删除的次数
+    int copies = 0;        // 传播掉的 copy
+    int phis = 0;          // 各入口相同或与同块另一 phi 重复的 phi
+};
+
+// 基于支配树的全局值编号：按支配树先序遍历，以 (操作码, 操作数) 为键的散列表按作用域
+// 记录可用的表达式，被支配的相同表达式改用先前的值。交换律与 a > b / b < a 归一后比较。
+// copy 直接替换为其源，冗余 phi 一并消去
+Preserved runGVN(Function& func, AnalysisManager& am, GVNStats& stats);
@@ -0,0 +1,371 @@
+#include "ir.h"
+#include <algorithm>
+#include <set>
+#include <stdexcept>
+
+void Value::replaceAllUsesWith(Value* v) {
+    if (v == this) return;
+    auto oldUsers = users;
+    for (auto* user : oldUsers) {
+        for (size_t i = 0; i < user->operands.size(); ++i) {
+            if (user->operands[i] == this) {
+                user->setOperand(i, v);
+            }
+        }
+    }
+}
+
+static void removeUser(Value* v, Instruction* user) {
+    auto it = std::find(v->users.begin(), v->users.end(), user);
+    if (it != v->users.end()) v->users.erase(it);
+}
+
+void Instruction::setOperand(size_t i, Value* v) {
+    if (operands[i] == v) return;
+    if (operands[i]) removeUser(operands[i], this);
+    operands[i] = v;
+    if (v) v->users.push_back(this);
+}
+
+void Instruction::addOperand(Value* v) {
+    operands.push_back(v);
+    if (v) v->users.push_back(this);
+}
+
+void Instruction::removeOperand(size_t i) {
+    if (operands[i]) removeUser(operands[i], this);
+    operands.erase(operands.begin() + i);
+}
+
+void Instruction::dropAllOperands() {
+    for (auto* v : operands) {
+        if (v) removeUser(v, this);
+    }
+    operands.clear();
+}
+
+void Instruction::addIncoming(Value* v, BasicBlock* bb) {
+    addOperand(v);
+    blocks.push_back(bb);
+}
+
+Value* Instruction::getIncomingValue(const BasicBlock* bb) const {
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        if (blocks[i] == bb) return operands[i];
+    }
+    return nullptr;
+}
+
+void Instruction::removeIncoming(const BasicBlock* bb) {
+    for (size_t i = 0; i < blocks.size(); ) {
+        if (blocks[i] == bb) {
+            removeOperand(i);
+            blocks.erase(blocks.begin() + i);
+        }
+        else {
+            ++i;
+        }
+    }
+}
+
+void Instruction::replaceBlock(BasicBlock* from, BasicBlock* to) {
+    for (auto& bb : blocks) {
+        if (bb == from) bb = to;
+    }
+}
+
+std::unique_ptr<Instruction> makeInst(Opcode op, IRType type, std::vector<Value*> operands) {
+    auto inst = std::make_unique<Instruction>(op, type);
+    for (auto* v : operands) {
+        inst->addOperand(v);
+    }
+    return inst;
+}
+
+// ---------------- BasicBlock ----------------
+
+Instruction* BasicBlock::terminator() const {
+    if (insts.empty() || !insts.back()->isTerminator()) return nullptr;
+    return insts.back().get();
+}
+
+std::vector<BasicBlock*> BasicBlock::succs() const {
+    auto* term = terminator();
+    if (!term) return {};
+    return term->blocks;
+}
+
+Instruction* BasicBlock::append(std::unique_ptr<Instruction> inst) {
+    inst->parent = this;
+    insts.push_back(std::move(inst));
+    return insts.back().get();
+}
+
+std::list<std::unique_ptr<Instruction>>::iterator BasicBlock::find(const Instruction* inst) {
+    for (auto it = insts.begin(); it != insts.end(); ++it) {
+        if (it->get() == inst) return it;
+    }
+    return insts.end();
+}
+
+Instruction* BasicBlock::insertBefore(Instruction* pos, std::unique_ptr<Instruction> inst) {
+    inst->parent = this;
+    auto it = insts.insert(find(pos), std::move(inst));
+    return it->get();
+}
+
+Instruction* BasicBlock::insertBeforeTerminator(std::unique_ptr<Instruction> inst) {
+    auto* term = terminator();
+    if (!term) return append(std::move(inst));
+    return insertBefore(term, std::move(inst));
+}
+
+Instruction* BasicBlock::insertAfterPhis(std::unique_ptr<Instruction> inst) {
+    auto it = insts.begin();
+    while (it != insts.end() && (*it)->isPhi()) ++it;
+    inst->parent = this;
+    return insts.insert(it, std::move(inst))->get();
+}
+
+std::unique_ptr<Instruction> BasicBlock::remove(Instruction* inst) {
+    auto it = find(inst);
+    if (it == insts.end()) throw std::runtime_error("instruction not in block " + name);
+    auto owned = std::move(*it);
+    insts.erase(it);
+    owned->parent = nullptr;
+    return owned;
+}
+
+void BasicBlock::erase(Instruction* inst) {
+    remove(inst)->dropAllOperands();
+}
+
+// ---------------- Function ----------------
+
+Function::~Function() {
+    // 先断开所有使用关系，避免析构顺序导致悬空访问
+    for (auto& bb : blocks) {
+        for (auto& inst : bb->insts) {
+            inst->dropAllOperands();
+        }
+    }
+}
+
+BasicBlock* Function::createBlock(const std::string& base) {
+    blocks.push_back(std::make_unique<BasicBlock>(this, parent->newLabel(base)));
+    return blocks.back().get();
+}
+
+Constant* Function::getConstant(int v) {
+    auto& slot = constants[v];
+    if (!slot) slot = std::make_unique<Constant>(v);
+    return slot.get();
+}
+
+void Function::recomputePreds() {
+    for (auto& bb : blocks) {
+        bb->preds.clear();
+    }
+    for (auto& bb : blocks) {
+        for (auto* succ : bb->succs()) {
+            if (std::find(succ->preds.begin(), succ->preds.end(), bb.get()) == succ->preds.end()) {
+                succ->preds.push_back(bb.get());
+            }
+        }
+    }
+}
+
+bool Function::removeUnreachableBlocks() {
+    std::set<BasicBlock*> reachable;
+    std::vector<BasicBlock*> worklist{ entry() };
+    reachable.insert(entry());
+    while (!worklist.empty()) {
+        auto* bb = worklist.back();
+        worklist.pop_back();
+        for (auto* succ : bb->succs()) {
+            if (reachable.insert(succ).second) worklist.push_back(succ);
+        }
+    }
+    if (reachable.size() == blocks.size()) return false;
+
+    for (auto& bb : blocks) {
+        if (reachable.count(bb.get())) continue;
+        for (auto* succ : bb->succs()) {
+            if (!reachable.count(succ)) continue;
+            for (auto& inst : succ->insts) {
+                if (!inst->isPhi()) break;
+                inst->removeIncoming(bb.get());
+            }
+        }
+        for (auto& inst : bb->insts) {
+            inst->dropAllOperands();
+        }
+    }
+    blocks.erase(std::remove_if(blocks.begin(), blocks.end(),
+        [&](const std::unique_ptr<BasicBlock>& bb) { return !reachable.count(bb.get()); }),
+        blocks.end());
+    recomputePreds();
+    return true;
+}
+
+BasicBlock* Function::splitEdge(BasicBlock* from, BasicBlock* to) {
+    auto pos = std::find_if(blocks.begin(), blocks.end(),
+        [&](const std::unique_ptr<BasicBlock>& bb) { return bb.get() == from; });
+    auto mid = std::make_unique<BasicBlock>(this, parent->newLabel("split"));
+    auto* midBB = mid.get();
+    blocks.insert(pos + 1, std::move(mid));
+
+    auto br = makeInst(Opcode::Br, IRType::Void);
+    br->blocks.push_back(to);
+    midBB->append(std::move(br));
+
+    from->terminator()->replaceBlock(to, midBB);
+    for (auto& inst : to->insts) {
+        if (!inst->isPhi()) break;
+        inst->replaceBlock(from, midBB);
+    }
+    std::replace(to->preds.begin(), to->preds.end(), from, midBB);
+    midBB->preds.push_back(from);
+    return midBB;
+}
+
+bool Function::splitCriticalEdges() {
+    bool changed = false;
+    std::vector<BasicBlock*> order;
+    for (auto& bb : blocks) order.push_back(bb.get());
+    for (auto* bb : order) {
+        auto succs = bb->succs();
+        if (succs.size() < 2) continue;
+        for (auto* succ : succs) {
+            if (succ->preds.size() > 1) {
+                splitEdge(bb, succ);
+                changed = true;
+            }
+        }
+    }
+    return changed;
+}
+
+int Function::numberValues() {
+    int next = 0;
+    for (auto& arg : args) {
+        arg->id = next++;
+    }
+    for (auto& bb : blocks) {
+        for (auto& inst : bb->insts) {
+            inst->id = next++;
+        }
+    }
+    return next;
+}
+
+size_t Function::instructionCount() const {
+    size_t n = 0;
+    for (auto& bb : blocks) {
+        n += bb->insts.size();
+    }
+    return n;
+}
+
+// ---------------- Module ----------------
+
+Function* Module::getFunction(const std::string& name) const {
+    for (auto& f : functions) {
+        if (f->name == name) return f.get();
+    }
+    return nullptr;
+}
+
+std::string Module::newLabel(const std::string& base) {
+    return base + "_" + std::to_string(labelCount++);
+}
+
+// ---------------- 打印 ----------------
+
+const char* opcodeName(Opcode op) {
+    switch (op) {
+    case Opcode::Add: return "add";
+    case Opcode::Sub: return "sub";
+    case Opcode::Mul: return "mul";
+    case Opcode::Div: return "div";
+    case Opcode::Rem: return "rem";
+    case Opcode::Shl: return "shl";
+    case Opcode::Lt: return "lt";
+    case Opcode::Gt: return "gt";
+    case Opcode::Le: return "le";
+    case Opcode::Ge: return "ge";
+    case Opcode::Eq: return "eq";
+    case Opcode::Ne: return "ne";
+    case Opcode::ZExt: return "zext";
+    case Opcode::Copy: return "copy";
+    case Opcode::Phi: return "phi";
+    case Opcode::Call: return "call";
+    case Opcode::Br: return "br";
+    case Opcode::CondBr: return "condbr";
+    case Opcode::Ret: return "ret";
+    }
+    return "?";
+}
+
+const char* typeName(IRType type) {
+    switch (type) {
+    case IRType::Void: return "void";
+    case IRType::I1: return "i1";
+    case IRType::I32: return "i32";
+    }
+    return "?";
+}
+
+static std::string valueName(const Value* v) {
+    if (auto* c = dynamic_cast<const Constant*>(v)) return std::to_string(c->value);
+    return "%" + std::to_string(v->id);
+}
+
+void printFunction(std::ostream& os, Function& func) {
+    func.numberValues();
+    os << "define " << typeName(func.retType) << " @" << func.name << "(";
+    for (size_t i = 0; i < func.args.size(); ++i) {
+        if (i) os << ", ";
+        os << "i32 " << valueName(func.args[i].get());
+    }
+    os << ") {\n";
+    for (auto& bb : func.blocks) {
+        os << bb->name << ":";
+        if (!bb->preds.empty()) {
+            os << "                ; preds:";
+            for (auto* p : bb->preds) os << " " << p->name;
+        }
+        os << "\n";
+        for (auto& inst : bb->insts) {
+            os << "    ";
+            if (inst->type != IRType::Void) {
+                os << valueName(inst.get()) << " = ";
+            }
+            os << opcodeName(inst->op);
+            if (inst->type != IRType::Void) os << " " << typeName(inst->type);
+            if (inst->op == Opcode::Call) os << " @" << inst->callee;
+            if (inst->isPhi()) {
+                for (size_t i = 0; i < inst->operands.size(); ++i) {
+                    os << (i ? ", " : " ") << "[ " << valueName(inst->operands[i]) << ", " << inst->blocks[i]->name << " ]";
+                }
+            }
+            else {
+                for (size_t i = 0; i < inst->operands.size(); ++i) {
+                    os << (i ? ", " : " ") << valueName(inst->operands[i]);
+                }
+                for (size_t i = 0; i < inst->blocks.size(); ++i) {
+                    os << ((i || !inst->operands.empty()) ? ", " : " ") << inst->blocks[i]->name;
+                }
+            }
+            os << "\n";
+        }
+    }
+    os << "}\n";
+}
+
+void printModule(std::ostream& os, Module& module) {
+    for (auto& func : module.functions) {
+        printFunction(os, *func);
+        os << "\n";
+    }
+}
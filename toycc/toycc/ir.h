@@ -0,0 +1,155 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <list>
+#include <map>
+#include <memory>
+#include <ostream>
+
+// 三地址 SSA 中间表示：函数由基本块组成，块内为带类型虚拟寄存器的指令序列
+enum class IRType { Void, I1, I32 };
+
+enum class Opcode {
+    // 算术 (i32 x i32 -> i32)
+    Add, Sub, Mul, Div, Rem, Shl,
+    // 比较 (i32 x i32 -> i1)
+    Lt, Gt, Le, Ge, Eq, Ne,
+    // i1 -> i32
+    ZExt,
+    Copy, Phi, Call,
+    // 终结指令
+    Br, CondBr, Ret
+};
+
+class Instruction;
+class BasicBlock;
+class Function;
+class Module;
+
+class Value {
+public:
+    enum class Kind { Constant, Argument, Instruction };
+
+    Value(Kind k, IRType t) : kind(k), type(t) {}
+    virtual ~Value() = default;
+
+    Kind kind;
+    IRType type;
+    int id = -1;
+    std::vector<Instruction*> users;   // 使用者列表，同一指令多次使用会出现多次
+
+    bool isConstant() const { return kind == Kind::Constant; }
+    bool isArgument() const { return kind == Kind::Argument; }
+    bool isInstruction() const { return kind == Kind::Instruction; }
+
+    void replaceAllUsesWith(Value* v);
+};
+
+class Constant : public Value {
+public:
+    explicit Constant(int v) : Value(Kind::Constant, IRType::I32), value(v) {}
+    int value;
+};
+
+class Argument : public Value {
+public:
+    Argument(int idx, std::string n) : Value(Kind::Argument, IRType::I32), index(idx), name(std::move(n)) {}
+    int index;
+    std::string name;
+};
+
+class Instruction : public Value {
+public:
+    Instruction(Opcode o, IRType t) : Value(Kind::Instruction, t), op(o) {}
+    ~Instruction() override { dropAllOperands(); }
+
+    Opcode op;
+    BasicBlock* parent = nullptr;
+    std::vector<Value*> operands;
+    std::vector<BasicBlock*> blocks;   // Phi: 各操作数的来源块; Br/CondBr: 跳转目标
+    std::string callee;                // Call
+
+    Value* getOperand(size_t i) const { return operands[i]; }
+    void setOperand(size_t i, Value* v);
+    void addOperand(Value* v);
+    void removeOperand(size_t i);
+    void dropAllOperands();
+
+    bool isTerminator() const { return op == Opcode::Br || op == Opcode::CondBr || op == Opcode::Ret; }
+    bool isPhi() const { return op == Opcode::Phi; }
+    bool isCompare() const { return op >= Opcode::Lt && op <= Opcode::Ne; }
+    bool hasSideEffects() const { return op == Opcode::Call || isTerminator(); }
+
+    // Phi 辅助
+    void addIncoming(Value* v, BasicBlock* bb);
+    Value* getIncomingValue(const BasicBlock* bb) const;
+    void removeIncoming(const BasicBlock* bb);
+
+    // 把跳转目标 / Phi 来源块中的 from 替换为 to
+    void replaceBlock(BasicBlock* from, BasicBlock* to);
+};
+
+class BasicBlock {
+public:
+    BasicBlock(Function* f, std::string n) : parent(f), name(std::move(n)) {}
+
+    Function* parent;
+    std::string name;
+    std::list<std::unique_ptr<Instruction>> insts;
+    std::vector<BasicBlock*> preds;
+
+    Instruction* terminator() const;
+    std::vector<BasicBlock*> succs() const;
+
+    Instruction* append(std::unique_ptr<Instruction> inst);
+    Instruction* insertBefore(Instruction* pos, std::unique_ptr<Instruction> inst);
+    Instruction* insertBeforeTerminator(std::unique_ptr<Instruction> inst);
+    Instruction* insertAfterPhis(std::unique_ptr<Instruction> inst);
+    std::unique_ptr<Instruction> remove(Instruction* inst);
+    void erase(Instruction* inst);
+
+    std::list<std::unique_ptr<Instruction>>::iterator find(const Instruction* inst);
+};
+
+class Function {
+public:
+    Function(Module* m, std::string n, IRType ret) : parent(m), name(std::move(n)), retType(ret) {}
+    ~Function();
+
+    Module* parent;
+    std::string name;
+    IRType retType;
+    std::vector<std::unique_ptr<Argument>> args;
+    std::vector<std::unique_ptr<BasicBlock>> blocks;   // 顺序即代码布局顺序，首块为入口
+
+    BasicBlock* entry() const { return blocks.front().get(); }
+    BasicBlock* createBlock(const std::string& base);
+    Constant* getConstant(int v);
+
+    void recomputePreds();
+    bool removeUnreachableBlocks();
+    bool splitCriticalEdges();
+    BasicBlock* splitEdge(BasicBlock* from, BasicBlock* to);
+
+    int numberValues();   // 为参数和指令重新分配连续编号，返回编号总数
+    size_t instructionCount() const;
+
+private:
+    std::map<int, std::unique_ptr<Constant>> constants;
+};
+
+class Module {
+public:
+    std::vector<std::unique_ptr<Function>> functions;
+    int labelCount = 0;
+
+    Function* getFunction(const std::string& name) const;
+    std::string newLabel(const std::string& base);
+};
+
+std::unique_ptr<Instruction> makeInst(Opcode op, IRType type, std::vector<Value*> operands = {});
+const char* opcodeName(Opcode op);
+const char* typeName(IRType type);
+
+void printFunction(std::ostream& os, Function& func);
+void printModule(std::ostream& os, Module& module);
@@ -0,0 +1,460 @@
+#include "irbuilder.h"
+#include <algorithm>
+#include <stdexcept>
+
+std::unique_ptr<Module> IRBuilder::build(const std::vector<std::shared_ptr<FuncDef>>& funcs) {
+    auto mod = std::make_unique<Module>();
+    module = mod.get();
+
+    for (const auto& def : funcs) {
+        funcRetTypes[def->name] = def->retType == "void" ? IRType::Void : IRType::I32;
+    }
+    for (const auto& def : funcs) {
+        buildFunc(def);
+    }
+    module = nullptr;
+    return mod;
+}
+
+void IRBuilder::buildFunc(const std::shared_ptr<FuncDef>& def) {
+    module->functions.push_back(std::make_unique<Function>(module, def->name, funcRetTypes[def->name]));
+    func = module->functions.back().get();
+
+    currentDef.clear();
+    incompletePhis.clear();
+    sealedBlocks.clear();
+    replacedPhis.clear();
+    exprLabels.clear();
+    scopes.clear();
+    varCount = 0;
+
+    auto* entry = func->createBlock("entry");
+    sealBlock(entry);
+    curBlock = entry;
+
+    // 形参作为入口块中的初始定义
+    enterScope();
+    for (size_t i = 0; i < def->params.size(); ++i) {
+        func->args.push_back(std::make_unique<Argument>(static_cast<int>(i), def->params[i].name));
+        writeVariable(declareVar(def->params[i].name), entry, func->args.back().get());
+    }
+
+    buildBlock(def->body);
+
+    // 函数末尾没有 return 时补一个
+    if (!isTerminated()) {
+        if (func->retType == IRType::Void) emit(Opcode::Ret, IRType::Void);
+        else emit(Opcode::Ret, IRType::Void, { func->getConstant(0) });
+    }
+    exitScope();
+
+    func->removeUnreachableBlocks();
+    func->recomputePreds();
+    deadPhis.clear();
+    pendingBlocks.clear();
+    func = nullptr;
+}
+
+// ---------------- 语句 ----------------
+
+void IRBuilder::buildBlock(const std::shared_ptr<BlockStmt>& block) {
+    enterScope();
+    for (const auto& stmt : block->statements) {
+        buildStmt(stmt);
+    }
+    exitScope();
+}
+
+void IRBuilder::buildStmt(const std::shared_ptr<Stmt>& stmt) {
+    // 终结指令之后的语句不可达，直接跳过
+    if (!stmt || isTerminated()) return;
+
+    if (auto decl = std::dynamic_pointer_cast<DeclareStmt>(stmt)) {
+        Value* value = toI32(buildExpr(decl->initVal));
+        writeVariable(declareVar(decl->varName), curBlock, value);
+    }
+    else if (auto assign = std::dynamic_pointer_cast<AssignStmt>(stmt)) {
+        Value* value = toI32(buildExpr(assign->value));
+        writeVariable(lookupVar(assign->varName), curBlock, value);
+    }
+    else if (auto ret = std::dynamic_pointer_cast<ReturnStmt>(stmt)) {
+        if (ret->value) {
+            Value* value = toI32(buildExpr(ret->value));
+            emit(Opcode::Ret, IRType::Void, { value });
+        }
+        else {
+            emit(Opcode::Ret, IRType::Void);
+        }
+        curBlock = nullptr;
+    }
+    else if (auto block = std::dynamic_pointer_cast<BlockStmt>(stmt)) {
+        buildBlock(block);
+    }
+    else if (auto exprstmt = std::dynamic_pointer_cast<ExprStmt>(stmt)) {
+        if (exprstmt->expr) buildExpr(exprstmt->expr);
+    }
+    else if (auto ifstmt = std::dynamic_pointer_cast<IfStmt>(stmt)) {
+        auto* thenBB = newBlock("then");
+        auto* elseBB = ifstmt->elseStmt ? newBlock("else") : nullptr;
+        auto* endBB = newBlock("endif");
+
+        buildCond(ifstmt->condition, thenBB, elseBB ? elseBB : endBB);
+        sealBlock(thenBB);
+        setInsertPoint(thenBB);
+        buildStmt(ifstmt->thenStmt);
+        if (!isTerminated()) emitBr(endBB);
+
+        if (elseBB) {
+            sealBlock(elseBB);
+            setInsertPoint(elseBB);
+            buildStmt(ifstmt->elseStmt);
+            if (!isTerminated()) emitBr(endBB);
+        }
+        sealBlock(endBB);
+        setInsertPoint(endBB);
+    }
+    else if (auto whilestmt = std::dynamic_pointer_cast<WhileStmt>(stmt)) {
+        auto* headerBB = newBlock("loop");
+        auto* bodyBB = newBlock("body");
+        auto* endBB = newBlock("endloop");
+
+        emitBr(headerBB);
+        setInsertPoint(headerBB);
+        buildCond(whilestmt->condition, bodyBB, endBB);
+
+        continueTargets.push_back(headerBB);
+        breakTargets.push_back(endBB);
+
+        sealBlock(bodyBB);
+        setInsertPoint(bodyBB);
+        buildStmt(whilestmt->body);
+        if (!isTerminated()) emitBr(headerBB);
+
+        continueTargets.pop_back();
+        breakTargets.pop_back();
+
+        // 回边全部就位后才能封闭循环头
+        sealBlock(headerBB);
+        sealBlock(endBB);
+        setInsertPoint(endBB);
+    }
+    else if (std::dynamic_pointer_cast<BreakStmt>(stmt)) {
+        if (breakTargets.empty()) throw std::runtime_error("break outside loop");
+        emitBr(breakTargets.back());
+        curBlock = nullptr;
+    }
+    else if (std::dynamic_pointer_cast<ContinueStmt>(stmt)) {
+        if (continueTargets.empty()) throw std::runtime_error("continue outside loop");
+        emitBr(continueTargets.back());
+        curBlock = nullptr;
+    }
+    else {
+        throw std::runtime_error("Unknown statement");
+    }
+}
+
+// 条件直接编译为跳转：&& / || 短路求值，! 交换两个目标，不生成 0/1 中间值
+void IRBuilder::buildCond(const std::shared_ptr<Expr>& expr, BasicBlock* trueBB, BasicBlock* falseBB) {
+    auto bin = std::dynamic_pointer_cast<BinaryExpr>(expr);
+    if (bin && bin->op == "!") {
+        buildCond(bin->rhs, falseBB, trueBB);
+        return;
+    }
+    if (bin && (bin->op == "&&" || bin->op == "||")) {
+        auto* rhsBB = newBlock(bin->op == "&&" ? "and_rhs" : "or_rhs");
+        if (bin->op == "&&") buildCond(bin->lhs, rhsBB, falseBB);
+        else buildCond(bin->lhs, trueBB, rhsBB);
+        sealBlock(rhsBB);
+        setInsertPoint(rhsBB);
+        buildCond(bin->rhs, trueBB, falseBB);
+        return;
+    }
+    emitCondBr(toBool(buildExpr(expr)), trueBB, falseBB);
+}
+
+// 作为值使用的 && / ||：左侧已决定结果时直接跳到汇合块，结果由 phi 汇合。
+// 借用一个不在作用域中的临时变量，phi 由 SSA 构造自动生成
+Value* IRBuilder::buildLogical(const std::shared_ptr<BinaryExpr>& bin) {
+    bool isAnd = bin->op == "&&";
+    auto* rhsBB = newBlock(isAnd ? "and_rhs" : "or_rhs");
+    auto* endBB = newBlock(isAnd ? "and_end" : "or_end");
+    int result = varCount++;
+
+    writeVariable(result, curBlock, func->getConstant(isAnd ? 0 : 1));
+    if (isAnd) buildCond(bin->lhs, rhsBB, endBB);
+    else buildCond(bin->lhs, endBB, rhsBB);
+    sealBlock(rhsBB);
+    setInsertPoint(rhsBB);
+    writeVariable(result, curBlock, toI32(toBool(buildExpr(bin->rhs))));
+    emitBr(endBB);
+    sealBlock(endBB);
+    setInsertPoint(endBB);
+    return readVariable(result, curBlock);
+}
+
+// ---------------- 表达式 ----------------
+
+Value* IRBuilder::buildExpr(const std::shared_ptr<Expr>& expr) {
+    if (auto num = std::dynamic_pointer_cast<NumberExpr>(expr)) {
+        return func->getConstant(num->value);
+    }
+    if (auto var = std::dynamic_pointer_cast<VariableExpr>(expr)) {
+        return readVariable(lookupVar(var->name), curBlock);
+    }
+    if (auto call = std::dynamic_pointer_cast<CallExpr>(expr)) {
+        std::vector<Value*> args(call->args.size());
+        for (size_t i : argOrder(call)) {
+            args[i] = toI32(buildExpr(call->args[i]));
+        }
+        auto it = funcRetTypes.find(call->callee);
+        IRType retType = it != funcRetTypes.end() ? it->second : IRType::I32;
+        auto* inst = emit(Opcode::Call, retType, args);
+        inst->callee = call->callee;
+        return inst;
+    }
+    if (auto bin = std::dynamic_pointer_cast<BinaryExpr>(expr)) {
+        if (bin->op == "&&" || bin->op == "||") {
+            return buildLogical(bin);
+        }
+        if (bin->op == "!") {
+            return emit(Opcode::Eq, IRType::I1, { toI32(buildExpr(bin->rhs)), func->getConstant(0) });
+        }
+        static const std::unordered_map<std::string, Opcode> opcodes = {
+            { "+", Opcode::Add }, { "-", Opcode::Sub }, { "*", Opcode::Mul },
+            { "/", Opcode::Div }, { "%", Opcode::Rem }, { "<<", Opcode::Shl },
+            { "<", Opcode::Lt }, { ">", Opcode::Gt }, { "<=", Opcode::Le },
+            { ">=", Opcode::Ge }, { "==", Opcode::Eq }, { "!=", Opcode::Ne },
+        };
+        auto it = opcodes.find(bin->op);
+        if (it == opcodes.end()) {
+            throw std::runtime_error("Unsupported binary operator: " + bin->op);
+        }
+        // 先求需要寄存器多的一侧；只有一侧含调用时先求该侧，使跨越调用的临时值更少；
+        // 两侧都含调用时保持源程序顺序
+        const ExprLabel& l = labelExpr(bin->lhs);
+        const ExprLabel& r = labelExpr(bin->rhs);
+        bool rhsFirst = l.hasCall != r.hasCall ? r.hasCall : (!l.hasCall && r.need > l.need);
+        Value* lhs = nullptr;
+        Value* rhs = nullptr;
+        if (rhsFirst) {
+            rhs = toI32(buildExpr(bin->rhs));
+            lhs = toI32(buildExpr(bin->lhs));
+        }
+        else {
+            lhs = toI32(buildExpr(bin->lhs));
+            rhs = toI32(buildExpr(bin->rhs));
+        }
+        auto* inst = emit(it->second, IRType::I32, { lhs, rhs });
+        if (inst->isCompare()) inst->type = IRType::I1;
+        return inst;
+    }
+    throw std::runtime_error("Unsupported expression type");
+}
+
+// 常量与变量 (值已在寄存器中) 不需要新寄存器；二元运算两侧相同时加一，否则取较大者。
+// 调用的参数按 argOrder 的顺序求值并全部保持到调用，结果占一个寄存器。
+const IRBuilder::ExprLabel& IRBuilder::labelExpr(const std::shared_ptr<Expr>& expr) {
+    auto it = exprLabels.find(expr.get());
+    if (it != exprLabels.end()) return it->second;
+
+    ExprLabel label;
+    if (auto bin = std::dynamic_pointer_cast<BinaryExpr>(expr)) {
+        const ExprLabel& l = labelExpr(bin->lhs);
+        const ExprLabel& r = labelExpr(bin->rhs);
+        label.need = l.need == r.need ? l.need + 1 : std::max(l.need, r.need);
+        label.hasCall = l.hasCall || r.hasCall;
+    }
+    else if (auto call = std::dynamic_pointer_cast<CallExpr>(expr)) {
+        auto order = argOrder(call);
+        label.need = 1;
+        for (size_t k = 0; k < order.size(); ++k) {
+            label.need = std::max(label.need, labelExpr(call->args[order[k]]).need + static_cast<int>(k));
+        }
+        label.hasCall = true;
+    }
+    return exprLabels[expr.get()] = label;
+}
+
+// 含调用的参数按源程序顺序最先求值，其余参数按所需寄存器数从多到少
+std::vector<size_t> IRBuilder::argOrder(const std::shared_ptr<CallExpr>& call) {
+    std::vector<size_t> order(call->args.size());
+    for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        const ExprLabel& la = labelExpr(call->args[a]);
+        const ExprLabel& lb = labelExpr(call->args[b]);
+        if (la.hasCall != lb.hasCall) return la.hasCall;
+        return !la.hasCall && la.need > lb.need;
+    });
+    return order;
+}
+
+Value* IRBuilder::toI32(Value* v) {
+    if (v->type == IRType::Void) throw std::runtime_error("void value used in expression");
+    if (v->type == IRType::I1) return emit(Opcode::ZExt, IRType::I32, { v });
+    return v;
+}
+
+Value* IRBuilder::toBool(Value* v) {
+    if (v->type == IRType::I1) return v;
+    return emit(Opcode::Ne, IRType::I1, { toI32(v), func->getConstant(0) });
+}
+
+// ---------------- 指令与基本块 ----------------
+
+Instruction* IRBuilder::emit(Opcode op, IRType type, std::vector<Value*> operands) {
+    return curBlock->append(makeInst(op, type, std::move(operands)));
+}
+
+void IRBuilder::emitBr(BasicBlock* target) {
+    auto* br = emit(Opcode::Br, IRType::Void);
+    br->blocks.push_back(target);
+    target->preds.push_back(curBlock);
+}
+
+void IRBuilder::emitCondBr(Value* cond, BasicBlock* trueBB, BasicBlock* falseBB) {
+    auto* br = emit(Opcode::CondBr, IRType::Void, { cond });
+    br->blocks = { trueBB, falseBB };
+    trueBB->preds.push_back(curBlock);
+    falseBB->preds.push_back(curBlock);
+}
+
+void IRBuilder::setInsertPoint(BasicBlock* bb) {
+    // 没有前驱的块不可达 (如两个分支都已 return)，其后代码不再生成
+    curBlock = bb->preds.empty() ? nullptr : bb;
+
+    // 块在开始生成代码时才加入函数，使布局顺序与源码顺序一致
+    auto it = pendingBlocks.find(bb);
+    if (it != pendingBlocks.end()) {
+        func->blocks.push_back(std::move(it->second));
+        pendingBlocks.erase(it);
+    }
+}
+
+BasicBlock* IRBuilder::newBlock(const std::string& base) {
+    auto bb = std::make_unique<BasicBlock>(func, module->newLabel(base));
+    auto* raw = bb.get();
+    pendingBlocks[raw] = std::move(bb);
+    return raw;
+}
+
+bool IRBuilder::isTerminated() const {
+    return curBlock == nullptr;
+}
+
+// ---------------- 作用域 ----------------
+
+void IRBuilder::enterScope() {
+    scopes.emplace_back();
+}
+
+void IRBuilder::exitScope() {
+    scopes.pop_back();
+}
+
+int IRBuilder::declareVar(const std::string& name) {
+    int id = varCount++;
+    scopes.back()[name] = id;
+    return id;
+}
+
+int IRBuilder::lookupVar(const std::string& name) const {
+    for (auto it = scopes.rbegin(); it != scopes.rend(); ++it) {
+        auto found = it->find(name);
+        if (found != it->end()) return found->second;
+    }
+    throw std::runtime_error("Undeclared variable: " + name);
+}
+
+// ---------------- SSA 构造 ----------------
+
+void IRBuilder::writeVariable(int var, BasicBlock* bb, Value* value) {
+    currentDef[bb][var] = value;
+}
+
+Value* IRBuilder::readVariable(int var, BasicBlock* bb) {
+    auto& defs = currentDef[bb];
+    auto it = defs.find(var);
+    if (it != defs.end()) return resolve(it->second);
+    return readVariableRecursive(var, bb);
+}
+
+Value* IRBuilder::readVariableRecursive(int var, BasicBlock* bb) {
+    Value* value;
+    if (!sealedBlocks.count(bb)) {
+        // 前驱尚不完整，先放一个不完整的 phi
+        auto phi = makeInst(Opcode::Phi, IRType::I32);
+        phi->parent = bb;
+        bb->insts.push_front(std::move(phi));
+        incompletePhis[bb][var] = bb->insts.front().get();
+        value = bb->insts.front().get();
+    }
+    else if (bb->preds.size() == 1) {
+        value = readVariable(var, bb->preds[0]);
+    }
+    else {
+        auto phi = makeInst(Opcode::Phi, IRType::I32);
+        phi->parent = bb;
+        bb->insts.push_front(std::move(phi));
+        auto* phiInst = bb->insts.front().get();
+        // 先登记 phi 以打破环路上的无限递归
+        writeVariable(var, bb, phiInst);
+        value = addPhiOperands(var, phiInst);
+    }
+    writeVariable(var, bb, value);
+    return value;
+}
+
+Value* IRBuilder::addPhiOperands(int var, Instruction* phi) {
+    for (auto* pred : phi->parent->preds) {
+        phi->addIncoming(readVariable(var, pred), pred);
+    }
+    return tryRemoveTrivialPhi(phi);
+}
+
+Value* IRBuilder::tryRemoveTrivialPhi(Instruction* phi) {
+    Value* same = nullptr;
+    for (auto* op : phi->operands) {
+        if (op == same || op == phi) continue;
+        if (same) return phi;   // 至少两个不同的来源，不是平凡 phi
+        same = op;
+    }
+    if (!same) {
+        // 只有自引用或没有来源：值未定义
+        same = func->getConstant(0);
+    }
+
+    std::vector<Instruction*> users;
+    for (auto* user : phi->users) {
+        if (user != phi) users.push_back(user);
+    }
+    phi->replaceAllUsesWith(same);
+    replacedPhis[phi] = same;
+    auto removed = phi->parent->remove(phi);
+    removed->dropAllOperands();
+    deadPhis.push_back(std::move(removed));
+
+    for (auto* user : users) {
+        if (user->isPhi() && !replacedPhis.count(user)) {
+            tryRemoveTrivialPhi(user);
+        }
+    }
+    return resolve(same);
+}
+
+Value* IRBuilder::resolve(Value* v) const {
+    auto it = replacedPhis.find(v);
+    while (it != replacedPhis.end()) {
+        v = it->second;
+        it = replacedPhis.find(v);
+    }
+    return v;
+}
+
+void IRBuilder::sealBlock(BasicBlock* bb) {
+    auto pending = std::move(incompletePhis[bb]);
+    incompletePhis.erase(bb);
+    for (auto& [var, phi] : pending) {
+        addPhiOperands(var, phi);
+    }
+    sealedBlocks.insert(bb);
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include "ast.h"
+#include "ir.h"
+#include <unordered_map>
+#include <unordered_set>
+#include <string>
+#include <vector>
+#include <memory>
+
+// 由通过语义检查的 AST 构建 SSA 形式的 IR。
+// 局部变量不分配栈槽，在构建过程中直接提升为 SSA 值 (Braun et al. 的按需构造算法)。
+class IRBuilder {
+public:
+    std::unique_ptr<Module> build(const std::vector<std::shared_ptr<FuncDef>>& funcs);
+
+private:
+    Module* module = nullptr;
+    Function* func = nullptr;
+    BasicBlock* curBlock = nullptr;
+
+    std::unordered_map<std::string, IRType> funcRetTypes;
+
+    // 作用域：变量名 -> 变量编号
+    std::vector<std::unordered_map<std::string, int>> scopes;
+    int varCount = 0;
+
+    std::vector<BasicBlock*> breakTargets;
+    std::vector<BasicBlock*> continueTargets;
+
+    // SSA 构造状态
+    std::unordered_map<BasicBlock*, std::unordered_map<int, Value*>> currentDef;
+    std::unordered_map<BasicBlock*, std::unordered_map<int, Instruction*>> incompletePhis;
+    std::unordered_set<BasicBlock*> sealedBlocks;
+    std::unordered_map<Value*, Value*> replacedPhis;
+    std::vector<std::unique_ptr<Instruction>> deadPhis;
+
+    // Sethi-Ullman/Ershov 标号：表达式求值所需寄存器数，以及其中是否含调用
+    struct ExprLabel {
+        int need = 0;
+        bool hasCall = false;
+    };
+    std::unordered_map<const Expr*, ExprLabel> exprLabels;
+
+    // 已创建但尚未开始生成代码的块
+    std::unordered_map<BasicBlock*, std::unique_ptr<BasicBlock>> pendingBlocks;
+
+    void buildFunc(const std::shared_ptr<FuncDef>& def);
+    void buildStmt(const std::shared_ptr<Stmt>& stmt);
+    void buildBlock(const std::shared_ptr<BlockStmt>& block);
+    Value* buildExpr(const std::shared_ptr<Expr>& expr);
+    const ExprLabel& labelExpr(const std::shared_ptr<Expr>& expr);
+    std::vector<size_t> argOrder(const std::shared_ptr<CallExpr>& call);
+    void buildCond(const std::shared_ptr<Expr>& expr, BasicBlock* trueBB, BasicBlock* falseBB);
+    Value* buildLogical(const std::shared_ptr<BinaryExpr>& bin);
+
+    Value* toI32(Value* v);
+    Value* toBool(Value* v);
+
+    Instruction* emit(Opcode op, IRType type, std::vector<Value*> operands = {});
+    void emitBr(BasicBlock* target);
+    void emitCondBr(Value* cond, BasicBlock* trueBB, BasicBlock* falseBB);
+    void setInsertPoint(BasicBlock* bb);
+    BasicBlock* newBlock(const std::string& base);
+    bool isTerminated() const;
+
+    void enterScope();
+    void exitScope();
+    int declareVar(const std::string& name);
+    int lookupVar(const std::string& name) const;
+
+    void writeVariable(int var, BasicBlock* bb, Value* value);
+    Value* readVariable(int var, BasicBlock* bb);
+    Value* readVariableRecursive(int var, BasicBlock* bb);
+    Value* addPhiOperands(int var, Instruction* phi);
+    Value* tryRemoveTrivialPhi(Instruction* phi);
+    Value* resolve(Value* v) const;
+    void sealBlock(BasicBlock* bb);
+};
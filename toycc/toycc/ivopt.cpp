@@ -0,0 +1,355 @@
+#include "ivopt.h"
+#include "looputil.h"
+#include <algorithm>
+#include <climits>
+#include <iterator>
+#include <unordered_map>
+
+namespace {
+
+// 识别派生归纳变量时表达式的最大嵌套层数
+constexpr int kMaxDepth = 4;
+
+struct InductionVar {
+    Instruction* phi;
+    Value* init;                            // 来自前置块的初值
+    Value* step;                            // 循环不变的步长
+    std::vector<Instruction*> increments;   // 各回边带回的 phi + step (去重)
+};
+
+bool fitsInt(long long v) { return v >= INT_MIN && v <= INT_MAX; }
+
+// 归纳变量与常量的比较，常量一侧归一到右边
+struct Test {
+    Instruction* cmp;
+    Value* operand;   // phi 或它的某个自增
+    Opcode op;
+    long long bound;
+};
+
+class IVOpt {
+public:
+    IVOpt(Function& func, Loop* loop, LoopInfo& loops, DominatorTree& dom, IVStats& stats)
+        : func(func), loop(loop), loops(loops), dom(dom), stats(stats), pre(loop->preheader()) {}
+
+    bool run() {
+        for (auto& inst : loop->header->insts) {
+            if (!inst->isPhi()) break;
+            InductionVar iv;
+            if (recognize(inst.get(), iv)) ivs.push_back(iv);
+        }
+        if (ivs.empty()) return false;
+        bool changed = reduce();
+        // 强度削弱新建的变量也在其中，可作为替换的目标
+        for (size_t i = 0; i < ivs.size(); ++i) changed = replaceTests(ivs[i]) || changed;
+        return changed;
+    }
+
+private:
+    Function& func;
+    Loop* loop;
+    LoopInfo& loops;
+    DominatorTree& dom;
+    IVStats& stats;
+    BasicBlock* pre;
+    std::vector<InductionVar> ivs;
+
+    bool executesEveryIteration(const BasicBlock* bb) const {
+        for (auto* latch : loop->latches) {
+            if (!dom.dominates(bb, latch)) return false;
+        }
+        return true;
+    }
+
+    bool invariant(const Value* v) const {
+        return !v->isInstruction() || !loop->contains(static_cast<const Instruction*>(v)->parent);
+    }
+
+    InductionVar* find(const Value* phi) {
+        for (auto& iv : ivs) {
+            if (iv.phi == phi) return &iv;
+        }
+        return nullptr;
+    }
+
+    // inc 是否为 phi + step，返回步长
+    Value* stepOf(Instruction* phi, Value* inc) {
+        if (!inc->isInstruction() || invariant(inc)) return nullptr;
+        auto* inst = static_cast<Instruction*>(inc);
+        if (inst->op == Opcode::Add) {
+            if (inst->operands[0] == phi && invariant(inst->operands[1])) return inst->operands[1];
+            if (inst->operands[1] == phi && invariant(inst->operands[0])) return inst->operands[0];
+        }
+        if (inst->op == Opcode::Sub && inst->operands[0] == phi) {
+            if (auto* c = asConstant(inst->operands[1])) return func.getConstant(static_cast<int>(0u - static_cast<uint32_t>(c->value)));
+        }
+        return nullptr;
+    }
+
+    bool recognize(Instruction* phi, InductionVar& iv) {
+        if (phi->type != IRType::I32) return false;
+        iv.phi = phi;
+        iv.init = phi->getIncomingValue(pre);
+        iv.step = nullptr;
+        for (auto* latch : loop->latches) {
+            Value* inc = phi->getIncomingValue(latch);
+            Value* step = stepOf(phi, inc);
+            if (!step || (iv.step && iv.step != step)) return false;
+            iv.step = step;
+            auto* inst = static_cast<Instruction*>(inc);
+            if (std::find(iv.increments.begin(), iv.increments.end(), inst) == iv.increments.end()) iv.increments.push_back(inst);
+        }
+        return iv.step != nullptr;
+    }
+
+    // v 是否为某个归纳变量的仿射函数：对它加减、乘不变量或左移常数
+    InductionVar* affine(Value* v, int depth) {
+        if (!v->isInstruction() || invariant(v)) return nullptr;
+        auto* inst = static_cast<Instruction*>(v);
+        if (inst->isPhi()) return find(inst);
+        if (depth >= kMaxDepth || inst->operands.size() != 2) return nullptr;
+        Value* a = inst->operands[0];
+        Value* b = inst->operands[1];
+        switch (inst->op) {
+        case Opcode::Add:
+        case Opcode::Sub:
+        case Opcode::Mul:
+            if (invariant(b)) return affine(a, depth + 1);
+            if (invariant(a)) return affine(b, depth + 1);
+            return nullptr;
+        case Opcode::Shl:
+            return asConstant(b) ? affine(a, depth + 1) : nullptr;
+        default:
+            return nullptr;
+        }
+    }
+
+    // 在前置块末尾生成 a op b，两边都是常量或有单位元时直接折叠
+    Value* build(Opcode op, Value* a, Value* b) {
+        const Constant* ca = asConstant(a);
+        const Constant* cb = asConstant(b);
+        if (ca && cb) {
+            uint32_t x = static_cast<uint32_t>(ca->value);
+            uint32_t y = static_cast<uint32_t>(cb->value);
+            switch (op) {
+            case Opcode::Add: return func.getConstant(static_cast<int>(x + y));
+            case Opcode::Sub: return func.getConstant(static_cast<int>(x - y));
+            case Opcode::Mul: return func.getConstant(static_cast<int>(x * y));
+            case Opcode::Shl: return func.getConstant(static_cast<int>(x << (y & 31)));
+            default: break;
+            }
+        }
+        if (cb && cb->value == 0 && (op == Opcode::Add || op == Opcode::Sub || op == Opcode::Shl)) return a;
+        if (ca && ca->value == 0 && op == Opcode::Add) return b;
+        if (op == Opcode::Mul) {
+            if ((ca && ca->value == 0) || (cb && cb->value == 0)) return func.getConstant(0);
+            if (ca && ca->value == 1) return b;
+            if (cb && cb->value == 1) return a;
+        }
+        return pre->insertBeforeTerminator(makeInst(op, IRType::I32, { a, b }));
+    }
+
+    // 把 v 的表达式复制到前置块，其中的归纳变量 phi 换成 x
+    Value* evaluate(Value* v, const Instruction* phi, Value* x) {
+        if (v == phi) return x;
+        if (invariant(v)) return v;
+        auto* inst = static_cast<Instruction*>(v);
+        return build(inst->op, evaluate(inst->operands[0], phi, x), evaluate(inst->operands[1], phi, x));
+    }
+
+    bool reduce() {
+        bool changed = false;
+        for (auto* bb : loop->blocks) {
+            // 内层循环中的乘法由内层循环的变量负责；条件执行的乘法换成每轮都做的加法不一定划算
+            if (loops.loopFor(bb) != loop || !executesEveryIteration(bb)) continue;
+            for (auto it = bb->insts.begin(); it != bb->insts.end();) {
+                Instruction* inst = (it++)->get();
+                if (inst->op != Opcode::Mul && inst->op != Opcode::Shl) continue;
+                InductionVar* base = affine(inst, 0);
+                if (!base) continue;
+                InductionVar derived = strengthReduce(inst, *base);
+                inst->replaceAllUsesWith(derived.phi);
+                bb->erase(inst);
+                ivs.push_back(derived);
+                ++stats.reduced;
+                changed = true;
+            }
+        }
+        return changed;
+    }
+
+    // 派生变量 f(i) 成为新的 phi：初值 f(init)，在 i 的每个自增之后加 f(step) - f(0)
+    InductionVar strengthReduce(Instruction* inst, const InductionVar& base) {
+        InductionVar iv;
+        iv.init = evaluate(inst, base.phi, base.init);
+        iv.step = build(Opcode::Sub, evaluate(inst, base.phi, base.step), evaluate(inst, base.phi, func.getConstant(0)));
+        auto phi = makeInst(Opcode::Phi, IRType::I32);
+        iv.phi = loop->header->insertAfterPhis(std::move(phi));
+        iv.phi->addIncoming(iv.init, pre);
+
+        std::unordered_map<const Instruction*, Instruction*> next;
+        for (auto* inc : base.increments) {
+            BasicBlock* bb = inc->parent;
+            Instruction* after = std::next(bb->find(inc))->get();
+            next[inc] = bb->insertBefore(after, makeInst(Opcode::Add, IRType::I32, { iv.phi, iv.step }));
+            iv.increments.push_back(next[inc]);
+        }
+        for (auto* latch : loop->latches) {
+            auto* inc = static_cast<Instruction*>(base.phi->getIncomingValue(latch));
+            iv.phi->addIncoming(next.at(inc), latch);
+        }
+        return iv;
+    }
+
+    bool isIncrement(const InductionVar& iv, const Value* v) const {
+        return std::find(iv.increments.begin(), iv.increments.end(), v) != iv.increments.end();
+    }
+
+    // 与常量比较 phi 或其自增的指令
+    bool decode(const InductionVar& iv, Instruction* cmp, Test& test) const {
+        if (!cmp->isCompare() || !loop->contains(cmp->parent)) return false;
+        Value* a = cmp->operands[0];
+        Value* b = cmp->operands[1];
+        test.cmp = cmp;
+        test.op = cmp->op;
+        if (asConstant(a) && !asConstant(b)) {
+            std::swap(a, b);
+            test.op = swappedCompare(test.op);
+        }
+        const Constant* c = asConstant(b);
+        if (!c || (a != iv.phi && !isIncrement(iv, a))) return false;
+        test.operand = a;
+        test.bound = c->value;
+        return true;
+    }
+
+    // 由每条回边上的测试推出 phi 与其自增在循环中的取值范围
+    bool valueRange(const InductionVar& iv, long long& lo, long long& hi) const {
+        const Constant* init = asConstant(iv.init);
+        const Constant* step = asConstant(iv.step);
+        if (!init || !step || step->value == 0) return false;
+        long long s = step->value;
+        lo = hi = init->value;
+        for (auto* latch : loop->latches) {
+            Instruction* term = latch->terminator();
+            if (term->op != Opcode::CondBr || !term->operands[0]->isInstruction()) return false;
+            Test test;
+            if (!decode(iv, static_cast<Instruction*>(term->operands[0]), test)) return false;
+            // 归一为沿回边继续循环的条件
+            Opcode op = term->blocks[0] == loop->header ? test.op : negatedCompare(test.op);
+            if (term->blocks[0] == loop->header && term->blocks[1] == loop->header) return false;
+            // 下一轮 phi 的界：测试的是 phi 时还要加上一次步长
+            long long next;
+            if (s > 0 && (op == Opcode::Lt || op == Opcode::Le)) next = op == Opcode::Lt ? test.bound - 1 : test.bound;
+            else if (s < 0 && (op == Opcode::Gt || op == Opcode::Ge)) next = op == Opcode::Gt ? test.bound + 1 : test.bound;
+            else return false;
+            if (test.operand == iv.phi) next += s;
+            lo = std::min(lo, next);
+            hi = std::max(hi, next);
+        }
+        lo = std::min(lo, lo + s);
+        hi = std::max(hi, hi + s);
+        return fitsInt(lo) && fitsInt(hi);
+    }
+
+    // 除自增与比较外还有别的使用，替换后仍会留下
+    bool survives(const InductionVar& iv) const {
+        auto other = [&](const Instruction* user) {
+            if (user == iv.phi || isIncrement(iv, user)) return false;
+            Test test;
+            return !decode(iv, const_cast<Instruction*>(user), test);
+        };
+        for (auto* user : iv.phi->users) {
+            if (other(user)) return true;
+        }
+        for (auto* inc : iv.increments) {
+            for (auto* user : inc->users) {
+                if (other(user)) return true;
+            }
+        }
+        return false;
+    }
+
+    std::vector<Test> collectTests(const InductionVar& iv) const {
+        std::vector<Test> tests;
+        auto add = [&](Instruction* user) {
+            if (std::any_of(tests.begin(), tests.end(), [&](const Test& t) { return t.cmp == user; })) return;
+            Test test;
+            if (decode(iv, user, test)) tests.push_back(test);
+        };
+        for (auto* user : iv.phi->users) add(user);
+        for (auto* inc : iv.increments) {
+            for (auto* user : inc->users) add(user);
+        }
+        return tests;
+    }
+
+    bool replaceTests(const InductionVar& iv) {
+        long long lo, hi;
+        if (survives(iv) || !valueRange(iv, lo, hi)) return false;
+        std::vector<Test> tests = collectTests(iv);
+        long long s = asConstant(iv.step)->value;
+        long long init = asConstant(iv.init)->value;
+
+        for (auto& target : ivs) {
+            if (target.phi == iv.phi || !survives(target)) continue;
+            const Constant* tInit = asConstant(target.init);
+            const Constant* tStep = asConstant(target.step);
+            if (!tInit || !tStep || tStep->value % s != 0) continue;
+            // 取值范围内 target = a * iv + b 恒成立且不溢出，比较可以等价换算
+            long long a = tStep->value / s;
+            long long b = tInit->value - a * init;
+            if (a == 0 || !fitsInt(a * lo + b) || !fitsInt(a * hi + b)) continue;
+
+            std::vector<std::pair<Value*, long long>> rewritten;
+            for (auto& test : tests) {
+                Value* operand = target.phi;
+                if (test.operand != iv.phi) {
+                    operand = nullptr;
+                    for (auto* inc : target.increments) {
+                        if (dom.dominates(inc, test.cmp)) operand = inc;
+                    }
+                }
+                long long bound = a * test.bound + b;
+                if (!operand || !fitsInt(bound)) break;
+                rewritten.emplace_back(operand, bound);
+            }
+            if (rewritten.size() != tests.size()) continue;
+
+            for (size_t i = 0; i < tests.size(); ++i) {
+                Instruction* cmp = tests[i].cmp;
+                cmp->op = a > 0 ? tests[i].op : swappedCompare(tests[i].op);
+                cmp->setOperand(0, rewritten[i].first);
+                cmp->setOperand(1, func.getConstant(static_cast<int>(rewritten[i].second)));
+            }
+            stats.tests += static_cast<int>(tests.size());
+            ++stats.removed;
+            return true;
+        }
+        return false;
+    }
+};
+
+} // namespace
+
+Preserved runIVOpt(Function& func, AnalysisManager& am, IVStats& stats) {
+    if (am.loopInfo().size() == 0) return Preserved::All;
+
+    // 沿用同一份循环信息建立各循环的前置块，最后只让分析失效一次
+    bool cfgChanged = false;
+    for (auto* loop : am.loopInfo().loopsInnermostFirst()) {
+        if (loop->preheader() || loop->header == func.entry()) continue;
+        ensurePreheader(func, loop);
+        cfgChanged = true;
+    }
+    if (cfgChanged) am.invalidate(Preserved::None);
+
+    bool changed = false;
+    auto& loops = am.loopInfo();
+    for (auto* loop : loops.loopsInnermostFirst()) {
+        if (!loop->preheader()) continue;
+        changed = IVOpt(func, loop, loops, am.domTree(), stats).run() || changed;
+    }
+    if (cfgChanged) return Preserved::None;
+    return changed ? Preserved::CFG : Preserved::All;
+}
@@ -0,0 +1,18 @@
+#pragma once
+#include "ir.h"
+#include "analysis.h"
+
+struct IVStats {
+    int reduced = 0;   // 改为加法递推的乘法与移位
+    int tests = 0;     // 改写到另一个归纳变量上的比较
+    int removed = 0;   // 因此不再需要的计数器
+};
+
+// 归纳变量优化。基本归纳变量是 header 中的 phi，每条回边带回 phi + step (step 循环不变)；
+// 派生归纳变量是对它做加减不变量、乘不变量、左移常数得到的仿射值 a * i + b。
+// 强度削弱：循环中的乘法与移位若是派生归纳变量，改为 header 中新的 phi，初值 f(init) 在前置块算出，
+// 每轮在原计数器自增之后加上 f(step) - f(0)。
+// 线性函数测试替换：计数器除自增外只被与常量的比较使用时，把比较改写到另一个留下来的
+// 归纳变量上，计数器随之成为死代码。只在初值、步长、边界都是常量，
+// 由回边上的测试能推出取值范围、换算后不会溢出时进行
+Preserved runIVOpt(Function& func, AnalysisManager& am, IVStats& stats);
@@ -0,0 +1,129 @@
+#include "layout.h"
+#include <algorithm>
+
+namespace {
+
+// 各类边的相对权重，同一块的各出边按权重归一
+constexpr double kBackEdge = 9.0;
+constexpr double kLoopExit = 1.0;
+constexpr double kLoopEntry = 8.0;
+constexpr double kEarlyReturn = 2.0;
+constexpr double kNeutral = 5.0;
+// 循环头的频率为进入频率乘以该值，对应回边概率 0.9
+constexpr double kLoopScale = 10.0;
+
+class Layout {
+public:
+    Layout(Function& func, AnalysisManager& am) : func(func), loops(am.loopInfo()), dom(am.domTree()) {}
+
+    BlockLayout run() {
+        BlockLayout result;
+        computeFrequencies(result.frequency);
+        freq = &result.frequency;
+
+        std::vector<BasicBlock*> seeds;
+        for (auto& bb : func.blocks) seeds.push_back(bb.get());
+        std::unordered_set<const BasicBlock*> placed;
+        std::vector<BasicBlock*> order;
+        for (auto* seed : seeds) {
+            for (BasicBlock* cur = seed; cur && !placed.count(cur);) {
+                placed.insert(cur);
+                order.push_back(cur);
+                cur = bestSuccessor(cur, placed);
+            }
+        }
+
+        std::vector<std::unique_ptr<BasicBlock>> blocks;
+        for (auto* bb : order) {
+            auto it = std::find_if(func.blocks.begin(), func.blocks.end(),
+                [&](const std::unique_ptr<BasicBlock>& p) { return p.get() == bb; });
+            blocks.push_back(std::move(*it));
+        }
+        func.blocks = std::move(blocks);
+
+        for (auto& bb : func.blocks) {
+            if (loops.isLoopHeader(bb.get())) result.alignedHeaders.insert(bb.get());
+        }
+        return result;
+    }
+
+private:
+    Function& func;
+    LoopInfo& loops;
+    DominatorTree& dom;
+    const std::unordered_map<const BasicBlock*, double>* freq = nullptr;
+
+    bool isBackEdge(const BasicBlock* from, const BasicBlock* to) const {
+        Loop* loop = loops.loopFor(to);
+        return loop && loop->header == to && loop->contains(from);
+    }
+
+    // 除 phi 外只有一条 ret
+    bool onlyReturns(const BasicBlock* bb) const {
+        for (auto& inst : bb->insts) {
+            if (!inst->isPhi()) return inst->op == Opcode::Ret;
+        }
+        return false;
+    }
+
+    double weight(const BasicBlock* from, const BasicBlock* to) const {
+        if (isBackEdge(from, to)) return kBackEdge;
+        Loop* loop = loops.loopFor(from);
+        if (loop && !loop->contains(to)) return kLoopExit;
+        if (loops.isLoopHeader(to)) return kLoopEntry;
+        if (onlyReturns(to)) return kEarlyReturn;
+        return kNeutral;
+    }
+
+    double probability(const BasicBlock* from, const BasicBlock* to) const {
+        auto succs = from->succs();
+        if (succs.size() == 1) return 1.0;
+        double total = 0;
+        for (auto* s : succs) total += weight(from, s);
+        return weight(from, to) / total;
+    }
+
+    void computeFrequencies(std::unordered_map<const BasicBlock*, double>& f) const {
+        for (auto* bb : dom.reversePostOrder()) {
+            double sum = bb == func.entry() ? 1.0 : 0.0;
+            for (auto* pred : bb->preds) {
+                if (isBackEdge(pred, bb)) continue;
+                auto it = f.find(pred);
+                if (it != f.end()) sum += it->second * probability(pred, bb);
+            }
+            if (loops.isLoopHeader(bb)) sum *= kLoopScale;
+            f[bb] = sum;
+        }
+    }
+
+    double edgeFrequency(const BasicBlock* from, const BasicBlock* to) const {
+        auto it = freq->find(from);
+        return (it == freq->end() ? 0.0 : it->second) * probability(from, to);
+    }
+
+    // 最热的未放置后继；若它另有不低于这条边的未放置前驱 (回边除外)，留给那个前驱落入
+    BasicBlock* bestSuccessor(BasicBlock* bb, const std::unordered_set<const BasicBlock*>& placed) const {
+        BasicBlock* best = nullptr;
+        double bestFreq = -1;
+        for (auto* succ : bb->succs()) {
+            if (placed.count(succ)) continue;
+            double f = edgeFrequency(bb, succ);
+            if (f > bestFreq) {
+                best = succ;
+                bestFreq = f;
+            }
+        }
+        if (!best) return nullptr;
+        for (auto* pred : best->preds) {
+            if (pred == bb || placed.count(pred) || isBackEdge(pred, best)) continue;
+            if (edgeFrequency(pred, best) >= bestFreq) return nullptr;
+        }
+        return best;
+    }
+};
+
+} // namespace
+
+BlockLayout layoutBlocks(Function& func, AnalysisManager& am) {
+    return Layout(func, am).run();
+}
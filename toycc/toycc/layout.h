@@ -0,0 +1,18 @@
+#pragma once
+#include "ir.h"
+#include "analysis.h"
+#include <unordered_map>
+#include <unordered_set>
+
+// 基本块布局的结果：对齐到取指宽度的循环头，以及由静态分支概率估计的块执行频率
+struct BlockLayout {
+    std::unordered_set<const BasicBlock*> alignedHeaders;
+    std::unordered_map<const BasicBlock*, double> frequency;   // 入口为 1
+};
+
+// 按静态分支概率重排 func.blocks，让每个块尽量落入其最可能的后继：
+//   回边多半跳转，离开循环的边 (包括 break) 少见，进入只做返回的块 ("提前返回") 少见，
+//   进入循环的边多半发生，其余两路平分。
+// 由概率沿逆后序推出块频率 (循环头乘以估计的迭代次数)，按原顺序取种子块贪心成链：
+// 链接到最热的未放置后继，除非它另有更热的未放置前驱。CFG 不变
+BlockLayout layoutBlocks(Function& func, AnalysisManager& am);
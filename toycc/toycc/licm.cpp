@@ -0,0 +1,105 @@
+#include "licm.h"
+#include <unordered_map>
+
+std::unordered_set<std::string> findPureFunctions(Module& module) {
+    // 先假定没有循环的函数都纯，再反复剔除调用了非纯函数的，直到不动点；递归调用因此也被排除
+    std::unordered_set<std::string> pure;
+    std::unordered_map<std::string, std::vector<std::string>> callees;
+    for (auto& func : module.functions) {
+        AnalysisManager am(*func);
+        if (am.loopInfo().size() > 0) continue;
+        pure.insert(func->name);
+        for (auto& bb : func->blocks) {
+            for (auto& inst : bb->insts) {
+                if (inst->op == Opcode::Call) callees[func->name].push_back(inst->callee);
+            }
+        }
+    }
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (auto it = pure.begin(); it != pure.end();) {
+            bool keep = true;
+            for (auto& callee : callees[*it]) {
+                keep = keep && callee != *it && pure.count(callee);
+            }
+            if (keep) {
+                ++it;
+                continue;
+            }
+            it = pure.erase(it);
+            changed = true;
+        }
+    }
+    return pure;
+}
+
+// 每一轮完整的迭代都会执行到：所在块支配循环的每个回边源块
+static bool executesEveryIteration(const BasicBlock* bb, Loop* loop, DominatorTree& dom) {
+    for (auto* latch : loop->latches) {
+        if (!dom.dominates(bb, latch)) return false;
+    }
+    return true;
+}
+
+// 只要进入循环就至少执行一次：所在块支配每个有边离开循环的块。
+// 底部测试的循环中测试之前的块都是如此；仍在 header 测试的循环可能一次也不执行，循环体中的块都不满足
+static bool executesWheneverEntered(const BasicBlock* bb, Loop* loop, DominatorTree& dom) {
+    for (auto* block : loop->blocks) {
+        for (auto* succ : block->succs()) {
+            if (!loop->contains(succ) && !dom.dominates(bb, block)) return false;
+        }
+    }
+    return true;
+}
+
+Preserved runLICM(Function& func, AnalysisManager& am, const std::unordered_set<std::string>& pure, LICMStats& stats) {
+    if (am.loopInfo().size() == 0) return Preserved::All;
+
+    // 先统一建立前置块 (沿用同一份循环信息，最后只让分析失效一次)，之后的外提不再改变 CFG
+    bool cfgChanged = false;
+    for (auto* loop : am.loopInfo().loopsInnermostFirst()) {
+        if (loop->preheader()) continue;
+        ensurePreheader(func, loop);
+        cfgChanged = true;
+    }
+    if (cfgChanged) am.invalidate(Preserved::None);
+
+    auto& loops = am.loopInfo();
+    auto& dom = am.domTree();
+    bool changed = false;
+    for (auto* loop : loops.loopsInnermostFirst()) {
+        BasicBlock* pre = loop->preheader();
+        if (!pre) continue;
+        auto invariant = [&](const Value* v) {
+            return !v->isInstruction() || !loop->contains(static_cast<const Instruction*>(v)->parent);
+        };
+        int hoisted = 0;
+        // 按逆后序访问循环中的块，外提的指令在其使用者之前已移出
+        for (auto* bb : dom.reversePostOrder()) {
+            if (!loop->contains(bb)) continue;
+            for (auto it = bb->insts.begin(); it != bb->insts.end();) {
+                Instruction* inst = (it++)->get();
+                if (inst->isPhi() || inst->isTerminator() || inst->type == IRType::Void) continue;
+                if (inst->op == Opcode::Call
+                    && (!pure.count(inst->callee) || !executesEveryIteration(bb, loop, dom))) continue;
+                // 除法与调用代价高，不在循环一次也不执行时白白算一次
+                bool expensive = inst->op == Opcode::Div || inst->op == Opcode::Rem || inst->op == Opcode::Call;
+                if (expensive && !executesWheneverEntered(bb, loop, dom)) continue;
+                bool operandsInvariant = true;
+                for (auto* v : inst->operands) {
+                    operandsInvariant = operandsInvariant && invariant(v);
+                }
+                if (!operandsInvariant) continue;
+                if (inst->op == Opcode::Call) ++stats.calls;
+                pre->insertBeforeTerminator(bb->remove(inst));
+                ++hoisted;
+            }
+        }
+        if (hoisted > 0) ++stats.loops;
+        stats.instructions += hoisted;
+        changed = changed || hoisted > 0;
+    }
+    if (cfgChanged) return Preserved::None;
+    return changed ? Preserved::CFG : Preserved::All;
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include "ir.h"
+#include "analysis.h"
+#include <string>
+#include <unordered_set>
+
+struct LICMStats {
+    int instructions = 0;   // 移到前置块的指令，即循环每次迭代少执行的指令数之和
+    int calls = 0;          // 其中纯函数调用的个数
+    int loops = 0;          // 有指令外提的循环
+};
+
+// 纯函数：不含循环且只调用纯函数 (因而一定终止)。语言中没有全局变量与指针，
+// 调用的唯一影响就是返回值，这样的调用可以像算术一样移动
+std::unordered_set<std::string> findPureFunctions(Module& module);
+
+// 循环不变量外提：为每个循环建立前置块，由内向外把操作数都在循环外定义的运算移到前置块末尾。
+// 算术与比较在本目标上不会陷入 (除以 0 也有定义的结果)，可以投机执行；
+// 纯函数调用只从每轮迭代都执行的块 (支配所有回边源块) 外提，条件分支中的调用不动。
+// 除法、取余与调用代价高，还要求进入循环就一定执行 (支配所有离开循环的块)：
+// 旋转后的循环有守卫，循环体在前置块之后至少执行一次；未能旋转、仍在 header 测试的循环中它们留在原处
+Preserved runLICM(Function& func, AnalysisManager& am, const std::unordered_set<std::string>& pure, LICMStats& stats);
@@ -0,0 +1,370 @@
+#include "loopsplit.h"
+#include "looputil.h"
+#include <algorithm>
+#include <climits>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// 拆出的区间数上限
+constexpr size_t kMaxSegments = 6;
+// 每个函数因复制循环而增加的指令数上限
+constexpr int kGrowthBudget = 240;
+
+struct Latch {
+    BasicBlock* block;
+    Value* next;          // 沿这条回边带回的 iv + 1
+    BasicBlock* exit;     // 测试不成立时离开到的块
+};
+
+// 计数循环：iv 从常量 first 起每轮加 1，各回边源块在 next 到达 end 时离开
+struct CountedLoop {
+    Loop* loop;
+    BasicBlock* pre;
+    Instruction* iv;
+    long long first;
+    long long end;
+    std::vector<Latch> latches;
+    std::vector<Instruction*> compares;   // 循环中 iv 与常量的比较
+};
+
+// 迭代区间 [lo, hi)
+struct Segment {
+    long long lo;
+    long long hi;
+};
+
+// 比较写成 "iv op C" 的形式
+Opcode normalizedOp(const Instruction* cmp, const Instruction* iv) {
+    return cmp->operands[0] == iv ? cmp->op : swappedCompare(cmp->op);
+}
+
+long long constantOf(const Instruction* cmp, const Instruction* iv) {
+    return asConstant(cmp->operands[0] == iv ? cmp->operands[1] : cmp->operands[0])->value;
+}
+
+bool evaluate(const Instruction* cmp, const Instruction* iv, long long v) {
+    return evaluateCompare(normalizedOp(cmp, iv), v, constantOf(cmp, iv));
+}
+
+// 比较结果在 p - 1 与 p 之间可能改变的位置 p
+void splitPoints(const Instruction* cmp, const Instruction* iv, std::vector<long long>& points) {
+    long long c = constantOf(cmp, iv);
+    switch (normalizedOp(cmp, iv)) {
+    case Opcode::Eq:
+    case Opcode::Ne:
+        points.push_back(c);
+        points.push_back(c + 1);
+        break;
+    case Opcode::Lt:
+    case Opcode::Ge:
+        points.push_back(c);
+        break;
+    default:
+        points.push_back(c + 1);
+        break;
+    }
+}
+
+// 回边源块以 "next < n" 或 "next <= n" (n 为常量) 决定是否继续，求出离开时的 end
+bool latchTest(Loop* loop, BasicBlock* latch, Value* next, BasicBlock*& exit, long long& end) {
+    Instruction* term = latch->terminator();
+    if (term->op != Opcode::CondBr || !term->operands[0]->isInstruction()) return false;
+    bool continueOnTrue = term->blocks[0] == loop->header;
+    exit = term->blocks[continueOnTrue ? 1 : 0];
+    if (loop->contains(exit) || term->blocks[continueOnTrue ? 0 : 1] != loop->header) return false;
+    auto* cmp = static_cast<Instruction*>(term->operands[0]);
+    if (!cmp->isCompare()) return false;
+    Opcode op = cmp->op;
+    const Constant* bound = nullptr;
+    if (cmp->operands[0] == next) bound = asConstant(cmp->operands[1]);
+    else if (cmp->operands[1] == next) {
+        bound = asConstant(cmp->operands[0]);
+        op = swappedCompare(op);
+    }
+    if (!bound) return false;
+    if (!continueOnTrue) op = negatedCompare(op);
+    if (op == Opcode::Lt) end = bound->value;
+    else if (op == Opcode::Le) end = static_cast<long long>(bound->value) + 1;
+    else return false;
+    return true;
+}
+
+bool analyze(Function& func, Loop* loop, CountedLoop& c) {
+    c.loop = loop;
+    c.pre = loop->preheader();
+    if (!c.pre || !loop->subLoops.empty() || loop->header == func.entry()) return false;
+    c.iv = nullptr;
+    for (auto& inst : loop->header->insts) {
+        if (!inst->isPhi()) break;
+        const Constant* init = asConstant(inst->getIncomingValue(c.pre));
+        if (!init) continue;
+        std::vector<Latch> latches;
+        long long end = LLONG_MIN;
+        bool counted = true;
+        for (auto* latch : loop->latches) {
+            Value* v = inst->getIncomingValue(latch);
+            auto* next = v->isInstruction() ? static_cast<Instruction*>(v) : nullptr;
+            if (!next || next->op != Opcode::Add) {
+                counted = false;
+                break;
+            }
+            const Constant* step = next->operands[0] == inst.get() ? asConstant(next->operands[1])
+                : next->operands[1] == inst.get() ? asConstant(next->operands[0]) : nullptr;
+            BasicBlock* exit = nullptr;
+            long long latchEnd = 0;
+            if (!step || step->value != 1 || !latchTest(loop, latch, next, exit, latchEnd) || (end != LLONG_MIN && latchEnd != end)) {
+                counted = false;
+                break;
+            }
+            end = latchEnd;
+            latches.push_back({ latch, next, exit });
+        }
+        if (!counted || latches.empty() || init->value >= end || end > INT_MAX) continue;
+        c.iv = inst.get();
+        c.first = init->value;
+        c.end = end;
+        c.latches = latches;
+        break;
+    }
+    if (!c.iv) return false;
+
+    c.compares.clear();
+    for (auto* bb : loop->blocks) {
+        for (auto& inst : bb->insts) {
+            if (!inst->isCompare()) continue;
+            Value* a = inst->operands[0];
+            Value* b = inst->operands[1];
+            if ((a == c.iv && b->isConstant()) || (b == c.iv && a->isConstant())) c.compares.push_back(inst.get());
+        }
+    }
+    return !c.compares.empty();
+}
+
+class Splitter {
+public:
+    Splitter(Function& func, CountedLoop& c, DominatorTree& dom)
+        : func(func), c(c), loop(c.loop), header(c.loop->header), dom(dom) {}
+
+    // 按比较切分迭代空间；某区间的首次迭代走不到回边时之后的迭代都不会发生，到此截断
+    std::vector<Segment> segments() const {
+        std::vector<long long> points;
+        for (auto* cmp : c.compares) splitPoints(cmp, c.iv, points);
+        std::sort(points.begin(), points.end());
+        points.erase(std::unique(points.begin(), points.end()), points.end());
+        std::vector<Segment> result;
+        long long lo = c.first;
+        for (long long p : points) {
+            if (p <= lo || p >= c.end) continue;
+            result.push_back({ lo, p });
+            lo = p;
+        }
+        result.push_back({ lo, c.end });
+        for (size_t j = 0; j < result.size(); ++j) {
+            if (continues(result[j].lo)) continue;
+            result[j].hi = result[j].lo + 1;
+            result.resize(j + 1);
+            break;
+        }
+        return result;
+    }
+
+    void run(const std::vector<Segment>& segs, LoopSplitStats& stats) {
+        exits = findLoopExits(loop);
+        copies.emplace_back();
+        for (size_t j = 1; j < segs.size(); ++j) copies.push_back(cloneLoop(func, loop));
+        size_t last = segs.size() - 1;
+
+        // 出口块的 phi：回边源块的出口只有最后一个区间还会到达
+        for (auto& [from, to] : exits.edges) {
+            for (auto& inst : to->insts) {
+                if (!inst->isPhi()) break;
+                Value* v = inst->getIncomingValue(from);
+                for (size_t j = 1; j <= last; ++j) {
+                    if (j != last && isLatchExit(from, to)) continue;
+                    inst->addIncoming(copies[j].value(v), copies[j].block(from));
+                }
+                if (last > 0 && isLatchExit(from, to)) inst->removeIncoming(from);
+            }
+        }
+
+        // 区间 j 做完后经 link 块进入区间 j + 1，header 的 phi 取离开时沿回边带回的值
+        for (size_t j = 0; j < last; ++j) {
+            BasicBlock* link = func.createBlock("split");
+            BasicBlock* nextHeader = copies[j + 1].block(header);
+            for (auto& inst : header->insts) {
+                if (!inst->isPhi()) break;
+                Value* v = func.getConstant(static_cast<int>(segs[j].hi));
+                if (inst.get() != c.iv) {
+                    auto phi = makeInst(Opcode::Phi, inst->type);
+                    for (auto& l : c.latches) {
+                        phi->addIncoming(copies[j].value(inst->getIncomingValue(l.block)), copies[j].block(l.block));
+                    }
+                    v = link->append(std::move(phi));
+                }
+                auto* target = static_cast<Instruction*>(copies[j + 1].value(inst.get()));
+                target->removeIncoming(c.pre);
+                target->addIncoming(v, link);
+            }
+            link->append(jump(nextHeader));
+
+            bool single = segs[j].hi - segs[j].lo == 1;
+            for (auto& l : c.latches) {
+                BasicBlock* latch = copies[j].block(l.block);
+                latch->erase(latch->terminator());
+                if (single) {
+                    latch->append(jump(link));
+                    continue;
+                }
+                auto more = makeInst(Opcode::Lt, IRType::I1, { copies[j].value(l.next), func.getConstant(static_cast<int>(segs[j].hi)) });
+                Value* cond = latch->append(std::move(more));
+                auto br = makeInst(Opcode::CondBr, IRType::Void, { cond });
+                br->blocks = { copies[j].block(header), link };
+                latch->append(std::move(br));
+            }
+        }
+        if (segs[last].hi - segs[last].lo == 1) {
+            for (auto& l : c.latches) {
+                BasicBlock* latch = copies[last].block(l.block);
+                latch->erase(latch->terminator());
+                latch->append(jump(l.exit));
+            }
+        }
+        // 只有一次迭代的区间不再成环，header 的 phi 只剩进入时的值
+        for (size_t j = 0; j <= last; ++j) {
+            if (segs[j].hi - segs[j].lo > 1) continue;
+            for (auto& inst : copies[j].block(header)->insts) {
+                if (!inst->isPhi()) break;
+                for (auto& l : c.latches) inst->removeIncoming(copies[j].block(l.block));
+            }
+        }
+        func.recomputePreds();
+        // 循环后直接使用的值可能来自任一区间的出口，回边源块的出口只有最后一个区间还会到达
+        repairEscapingUses(exits, [&](Instruction* v, SSAUpdater& updater) {
+            for (size_t j = 0; j <= last; ++j) {
+                for (auto& [from, to] : exits.edges) {
+                    if ((j != last && isLatchExit(from, to)) || !dom.dominates(v->parent, from)) continue;
+                    updater.addDefinition(copies[j].block(from), copies[j].value(v));
+                }
+            }
+        });
+
+        // 每个区间中比较的结果不变；只有一次迭代的区间中 iv 也是常量。
+        // 原循环 (j = 0) 中的比较最后删除，之前还要用它求值
+        for (size_t j = last + 1; j-- > 0;) {
+            for (auto* cmp : c.compares) {
+                auto* copy = static_cast<Instruction*>(copies[j].value(cmp));
+                copy->replaceAllUsesWith(func.getConstant(evaluate(cmp, c.iv, segs[j].lo) ? 1 : 0));
+                copy->parent->erase(copy);
+                ++stats.folded;
+            }
+            if (segs[j].hi - segs[j].lo == 1) {
+                copies[j].value(c.iv)->replaceAllUsesWith(func.getConstant(static_cast<int>(segs[j].lo)));
+                ++stats.peeled;
+            }
+            foldBranches(copies[j]);
+        }
+        func.recomputePreds();
+        func.removeUnreachableBlocks();
+        func.recomputePreds();
+        // 拆分点都不在迭代范围内时只有一个区间，循环没有复制，只折叠了比较
+        if (segs.size() > 1) {
+            ++stats.loops;
+            stats.segments += static_cast<int>(segs.size());
+        }
+    }
+
+private:
+    Function& func;
+    CountedLoop& c;
+    Loop* loop;
+    BasicBlock* header;
+    DominatorTree& dom;
+
+    std::vector<LoopCopy> copies;   // 第 j 个区间，copies[0] 为原循环
+    LoopExits exits;
+
+    // iv 取 lo 的这次迭代能否到达某个回边源块
+    bool continues(long long lo) const {
+        std::unordered_set<const Instruction*> known(c.compares.begin(), c.compares.end());
+        std::unordered_set<const BasicBlock*> seen{ header };
+        std::vector<BasicBlock*> work{ header };
+        while (!work.empty()) {
+            BasicBlock* bb = work.back();
+            work.pop_back();
+            if (loop->latches.end() != std::find(loop->latches.begin(), loop->latches.end(), bb)) return true;
+            Instruction* term = bb->terminator();
+            std::vector<BasicBlock*> succs = bb->succs();
+            Value* cond = term->op == Opcode::CondBr ? term->operands[0] : nullptr;
+            if (cond && cond->isInstruction() && known.count(static_cast<const Instruction*>(cond))) {
+                succs = { term->blocks[evaluate(static_cast<Instruction*>(cond), c.iv, lo) ? 0 : 1] };
+            }
+            for (auto* succ : succs) {
+                if (loop->contains(succ) && seen.insert(succ).second) work.push_back(succ);
+            }
+        }
+        return false;
+    }
+
+    bool isLatchExit(const BasicBlock* from, const BasicBlock* to) const {
+        return std::any_of(c.latches.begin(), c.latches.end(), [&](const Latch& l) { return l.block == from && l.exit == to; });
+    }
+
+    std::unique_ptr<Instruction> jump(BasicBlock* to) {
+        auto br = makeInst(Opcode::Br, IRType::Void);
+        br->blocks.push_back(to);
+        return br;
+    }
+
+    // 折叠副本中条件已是常量的分支，被放弃的后继删去相应的 phi 来源
+    void foldBranches(const LoopCopy& copy) {
+        for (auto* original : loop->blocks) {
+            BasicBlock* bb = copy.block(original);
+            Instruction* term = bb->terminator();
+            if (term->op != Opcode::CondBr || !term->operands[0]->isConstant()) continue;
+            bool taken = asConstant(term->operands[0])->value != 0;
+            BasicBlock* keep = term->blocks[taken ? 0 : 1];
+            BasicBlock* drop = term->blocks[taken ? 1 : 0];
+            if (drop != keep) {
+                for (auto& inst : drop->insts) {
+                    if (!inst->isPhi()) break;
+                    inst->removeIncoming(bb);
+                }
+            }
+            bb->erase(term);
+            bb->append(jump(keep));
+        }
+    }
+};
+
+} // namespace
+
+Preserved runLoopSplit(Function& func, AnalysisManager& am, LoopSplitStats& stats) {
+    int budget = kGrowthBudget;
+    bool changed = false;
+    std::unordered_set<const BasicBlock*> rejected;   // 拆分后超出预算的循环 (按 header)
+    for (;;) {
+        Loop* target = nullptr;
+        CountedLoop counted;
+        std::vector<Segment> segs;
+        for (auto* loop : am.loopInfo().loopsInnermostFirst()) {
+            if (rejected.count(loop->header) || !analyze(func, loop, counted)) continue;
+            segs = Splitter(func, counted, am.domTree()).segments();
+            int growth = static_cast<int>(segs.size() - 1) * loopSize(loop);
+            if (segs.size() > kMaxSegments || growth > budget) {
+                rejected.insert(loop->header);
+                continue;
+            }
+            budget -= growth;
+            target = loop;
+            break;
+        }
+        if (!target) break;
+        Splitter(func, counted, am.domTree()).run(segs, stats);
+        am.invalidate(Preserved::None);
+        changed = true;
+    }
+    return changed ? Preserved::None : Preserved::All;
+}
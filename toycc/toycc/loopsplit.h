@@ -0,0 +1,18 @@
+#pragma once
+#include "ir.h"
+#include "analysis.h"
+
+struct LoopSplitStats {
+    int loops = 0;      // 拆分的循环
+    int segments = 0;   // 拆出的区间 (含剥离的单次迭代)
+    int peeled = 0;     // 其中只有一次迭代、不再成环的
+    int folded = 0;     // 各区间中折叠为常量的计数器比较
+};
+
+// 按下标区间拆分循环 (index-set splitting)：计数器从常量初值每轮加 1、各回边源块都测
+// "next < 常量" 的最内层循环中，"i == 5"、"i < 8" 这类计数器与常量的比较把迭代空间分成若干区间，
+// 每个区间内比较结果不变。把循环复制成依次执行的各区间，每份中的比较折叠为常量，
+// 只有一次迭代的区间 (如 i == 5) 即被剥离为直线代码。
+// 某个区间的首次迭代走不到回边 (如 "if (i == 8) break;") 时，其后的区间不会执行，迭代上界随之收紧。
+// 拆分点都在迭代范围之外时整个循环只有一个区间，不复制，只把比较折叠为常量
+Preserved runLoopSplit(Function& func, AnalysisManager& am, LoopSplitStats& stats);
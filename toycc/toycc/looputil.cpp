@@ -0,0 +1,105 @@
+#include "looputil.h"
+#include <algorithm>
+
+const Constant* asConstant(const Value* v) {
+    return v->isConstant() ? static_cast<const Constant*>(v) : nullptr;
+}
+
+Opcode swappedCompare(Opcode op) {
+    switch (op) {
+    case Opcode::Lt: return Opcode::Gt;
+    case Opcode::Gt: return Opcode::Lt;
+    case Opcode::Le: return Opcode::Ge;
+    case Opcode::Ge: return Opcode::Le;
+    default: return op;
+    }
+}
+
+Opcode negatedCompare(Opcode op) {
+    switch (op) {
+    case Opcode::Lt: return Opcode::Ge;
+    case Opcode::Gt: return Opcode::Le;
+    case Opcode::Le: return Opcode::Gt;
+    case Opcode::Ge: return Opcode::Lt;
+    case Opcode::Eq: return Opcode::Ne;
+    default: return Opcode::Eq;
+    }
+}
+
+bool evaluateCompare(Opcode op, long long a, long long b) {
+    switch (op) {
+    case Opcode::Lt: return a < b;
+    case Opcode::Gt: return a > b;
+    case Opcode::Le: return a <= b;
+    case Opcode::Ge: return a >= b;
+    case Opcode::Eq: return a == b;
+    default: return a != b;
+    }
+}
+
+int loopSize(const Loop* loop) {
+    int size = 0;
+    for (auto* bb : loop->blocks) {
+        for (auto& inst : bb->insts) size += inst->isPhi() ? 0 : 1;
+    }
+    return size;
+}
+
+BasicBlock* LoopCopy::block(BasicBlock* bb) const {
+    auto it = blocks.find(bb);
+    return it == blocks.end() ? bb : it->second;
+}
+
+Value* LoopCopy::value(Value* v) const {
+    auto it = values.find(v);
+    return it == values.end() ? v : it->second;
+}
+
+LoopCopy cloneLoop(Function& func, const Loop* loop) {
+    LoopCopy copy;
+    for (auto* bb : loop->blocks) copy.blocks[bb] = func.createBlock(bb->name);
+    std::vector<Instruction*> cloned;
+    for (auto* bb : loop->blocks) {
+        for (auto& inst : bb->insts) {
+            auto clone = makeInst(inst->op, inst->type, inst->operands);
+            clone->blocks = inst->blocks;
+            clone->callee = inst->callee;
+            Instruction* added = copy.blocks[bb]->append(std::move(clone));
+            copy.values[inst.get()] = added;
+            cloned.push_back(added);
+        }
+    }
+    for (auto* inst : cloned) {
+        for (size_t i = 0; i < inst->operands.size(); ++i) inst->setOperand(i, copy.value(inst->operands[i]));
+        for (auto& bb : inst->blocks) bb = copy.block(bb);
+    }
+    return copy;
+}
+
+LoopExits findLoopExits(const Loop* loop) {
+    LoopExits exits;
+    for (auto* bb : loop->blocks) {
+        for (auto* succ : bb->succs()) {
+            std::pair<BasicBlock*, BasicBlock*> edge(bb, succ);
+            if (!loop->contains(succ) && std::find(exits.edges.begin(), exits.edges.end(), edge) == exits.edges.end()) {
+                exits.edges.push_back(edge);
+            }
+        }
+    }
+    for (auto* bb : loop->blocks) {
+        for (auto& inst : bb->insts) {
+            std::vector<std::pair<Instruction*, size_t>> uses;
+            for (auto* user : inst->users) {
+                if (loop->contains(user->parent)) continue;
+                for (size_t i = 0; i < user->operands.size(); ++i) {
+                    if (user->operands[i] != inst.get()) continue;
+                    // 出口块 phi 沿出口边的来源由各遍另行处理
+                    if (user->isPhi() && loop->contains(user->blocks[i])) continue;
+                    if (std::find(uses.begin(), uses.end(), std::make_pair(user, i)) == uses.end()) uses.emplace_back(user, i);
+                }
+            }
+            if (!uses.empty()) exits.escaping.emplace_back(inst.get(), uses);
+        }
+    }
+    return exits;
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include "ir.h"
+#include "analysis.h"
+#include "ssaupdater.h"
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// 循环变换共用的工具
+
+const Constant* asConstant(const Value* v);   // 不是常量时返回 nullptr
+
+// 比较交换两个操作数后的操作码 (a < b 即 b > a)，Eq、Ne 不变
+Opcode swappedCompare(Opcode op);
+// 比较取反后的操作码
+Opcode negatedCompare(Opcode op);
+// 按比较操作码求 a op b
+bool evaluateCompare(Opcode op, long long a, long long b);
+
+// 循环中不含 phi 的指令数，用于估计复制循环的代价
+int loopSize(const Loop* loop);
+
+// 循环的一份副本：块与值到副本的映射，循环外的块与值映射到自身
+struct LoopCopy {
+    std::unordered_map<const BasicBlock*, BasicBlock*> blocks;
+    std::unordered_map<const Value*, Value*> values;
+
+    BasicBlock* block(BasicBlock* bb) const;
+    Value* value(Value* v) const;
+};
+
+// 复制循环的全部块，循环内的操作数、跳转目标与 phi 来源换成副本中的对应者。
+// 副本的入口与出口块 phi 的来源由调用者连接
+LoopCopy cloneLoop(Function& func, const Loop* loop);
+
+// 复制循环前记下的出口
+struct LoopExits {
+    std::vector<std::pair<BasicBlock*, BasicBlock*>> edges;   // (循环中的块, 出口块)，不重复
+    // 循环后不经出口块 phi 直接使用的值及其使用处 (user, 操作数下标)
+    std::vector<std::pair<Instruction*, std::vector<std::pair<Instruction*, size_t>>>> escaping;
+};
+
+LoopExits findLoopExits(const Loop* loop);
+
+// 复制后循环后直接使用的值有多个到达的定义：define(v, updater) 登记 v 在各出口处的值，
+// 再按需在汇合处建立 phi 改写这些使用。调用前须先 recomputePreds
+template <typename Define>
+void repairEscapingUses(const LoopExits& exits, Define define) {
+    for (auto& [v, uses] : exits.escaping) {
+        SSAUpdater updater(v->type);
+        define(v, updater);
+        for (auto& [user, i] : uses) updater.rewriteUse(user, i);
+        updater.removeTrivialPhis();
+    }
+}
@@ -0,0 +1,186 @@
+#include "machine.h"
+
+const char* regName(Reg reg) {
+    static const char* names[] = {
+        "zero", "ra", "sp", "gp", "tp", "t0", "t1", "t2",
+        "s0", "s1", "a0", "a1", "a2", "a3", "a4", "a5",
+        "a6", "a7", "s2", "s3", "s4", "s5", "s6", "s7",
+        "s8", "s9", "s10", "s11", "t3", "t4", "t5", "t6",
+    };
+    return reg == Reg::None ? "?" : names[static_cast<int>(reg)];
+}
+
+const char* opName(MOp op) {
+    static const char* names[] = {
+        "li", "lui", "mv", "neg", "seqz", "snez",
+        "add", "sub", "mul", "div", "rem", "sll", "slt",
+        "addi", "slti", "andi", "xori", "slli", "srli", "srai",
+        "lw", "sw",
+        "beq", "bne", "blt", "bge", "beqz", "bnez", "bltz", "bgez", "blez", "bgtz", "j", "call", "ret",
+        "label",
+    };
+    return names[static_cast<int>(op)];
+}
+
+MOp invertBranch(MOp op) {
+    switch (op) {
+    case MOp::Beq: return MOp::Bne;
+    case MOp::Bne: return MOp::Beq;
+    case MOp::Blt: return MOp::Bge;
+    case MOp::Bge: return MOp::Blt;
+    case MOp::Beqz: return MOp::Bnez;
+    case MOp::Bnez: return MOp::Beqz;
+    case MOp::Bltz: return MOp::Bgez;
+    case MOp::Bgez: return MOp::Bltz;
+    case MOp::Blez: return MOp::Bgtz;
+    default: return MOp::Blez;
+    }
+}
+
+MachineInstr MachineInstr::rr(MOp op, Reg rd, Reg rs1, Reg rs2) {
+    MachineInstr mi;
+    mi.op = op;
+    mi.rd = rd;
+    mi.rs1 = rs1;
+    mi.rs2 = rs2;
+    return mi;
+}
+
+MachineInstr MachineInstr::ri(MOp op, Reg rd, Reg rs1, int imm) {
+    MachineInstr mi;
+    mi.op = op;
+    mi.rd = rd;
+    mi.rs1 = rs1;
+    mi.imm = imm;
+    return mi;
+}
+
+MachineInstr MachineInstr::unary(MOp op, Reg rd, Reg rs1) {
+    return rr(op, rd, rs1, Reg::None);
+}
+
+MachineInstr MachineInstr::li(Reg rd, int imm) {
+    return ri(MOp::Li, rd, Reg::None, imm);
+}
+
+MachineInstr MachineInstr::load(Reg rd, int offset, Reg base) {
+    return ri(MOp::Lw, rd, base, offset);
+}
+
+MachineInstr MachineInstr::store(Reg src, int offset, Reg base) {
+    MachineInstr mi = ri(MOp::Sw, Reg::None, base, offset);
+    mi.rs2 = src;
+    return mi;
+}
+
+MachineInstr MachineInstr::branch(MOp op, Reg rs1, Reg rs2, std::string_view target) {
+    MachineInstr mi = rr(op, Reg::None, rs1, rs2);
+    mi.label = target;
+    return mi;
+}
+
+MachineInstr MachineInstr::jump(std::string_view target) {
+    MachineInstr mi;
+    mi.op = MOp::J;
+    mi.label = target;
+    return mi;
+}
+
+MachineInstr MachineInstr::call(std::string_view callee) {
+    MachineInstr mi;
+    mi.op = MOp::Call;
+    mi.label = callee;
+    return mi;
+}
+
+MachineInstr MachineInstr::ret() {
+    MachineInstr mi;
+    mi.op = MOp::Ret;
+    return mi;
+}
+
+MachineInstr MachineInstr::labelDef(std::string_view name, int align) {
+    MachineInstr mi;
+    mi.op = MOp::Label;
+    mi.label = name;
+    mi.imm = align;
+    return mi;
+}
+
+Reg MachineInstr::def() const {
+    return op <= MOp::Lw ? rd : Reg::None;
+}
+
+bool MachineInstr::reads(Reg reg) const {
+    switch (op) {
+    case MOp::Li: case MOp::Lui: case MOp::J: case MOp::Label:
+        return false;
+    case MOp::Call:
+        // 参数寄存器与 sp
+        return (reg >= Reg::a0 && reg <= Reg::a7) || reg == Reg::sp;
+    case MOp::Ret:
+        // 返回值与被调用者保存的寄存器
+        return reg == Reg::a0 || reg == Reg::ra || reg == Reg::sp || isCalleeSaved(reg);
+    default:
+        return rs1 == reg || rs2 == reg;
+    }
+}
+
+void AsmPrinter::printHeader() {
+    out << "    .text\n";
+}
+
+void AsmPrinter::print(const MachineFunction& func) {
+    if (func.name == "main") out << "    .globl main\n";
+    out << "    " << func.name << ":\n";
+    for (auto& mi : func.code) {
+        print(mi);
+    }
+}
+
+void AsmPrinter::print(const MachineInstr& mi) {
+    out << "    ";
+    if (mi.isLabel()) {
+        if (mi.imm > 0) out << ".p2align " << mi.imm << "\n    ";
+        out << mi.label << ":\n";
+        return;
+    }
+    out << opName(mi.op);
+    switch (mi.op) {
+    case MOp::Li:
+        out << " " << regName(mi.rd) << ", " << mi.imm;
+        break;
+    case MOp::Lui:
+        out << " " << regName(mi.rd) << ", 0x";
+        out.putHex(static_cast<uint32_t>(mi.imm));
+        break;
+    case MOp::Mv: case MOp::Neg: case MOp::Seqz: case MOp::Snez:
+        out << " " << regName(mi.rd) << ", " << regName(mi.rs1);
+        break;
+    case MOp::Lw:
+        out << " " << regName(mi.rd) << ", " << mi.imm << "(" << regName(mi.rs1) << ")";
+        break;
+    case MOp::Sw:
+        out << " " << regName(mi.rs2) << ", " << mi.imm << "(" << regName(mi.rs1) << ")";
+        break;
+    case MOp::J: case MOp::Call:
+        out << " " << mi.label;
+        break;
+    case MOp::Ret:
+        break;
+    default:
+        if (mi.isBranch()) {
+            out << " " << regName(mi.rs1);
+            if (mi.rs2 != Reg::None) out << ", " << regName(mi.rs2);
+            out << ", " << mi.label;
+        }
+        else if (mi.op >= MOp::Addi) {
+            out << " " << regName(mi.rd) << ", " << regName(mi.rs1) << ", " << mi.imm;
+        }
+        else {
+            out << " " << regName(mi.rd) << ", " << regName(mi.rs1) << ", " << regName(mi.rs2);
+        }
+        break;
+    }
+    out << "\n";
+}
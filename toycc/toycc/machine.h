@@ -0,0 +1,89 @@
+#pragma once
+#include "asmwriter.h"
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// RV32 整数寄存器，按硬件编号 x0-x31 排列
+enum class Reg : uint8_t {
+    zero, ra, sp, gp, tp, t0, t1, t2,
+    s0, s1, a0, a1, a2, a3, a4, a5,
+    a6, a7, s2, s3, s4, s5, s6, s7,
+    s8, s9, s10, s11, t3, t4, t5, t6,
+    None = 0xff
+};
+
+const char* regName(Reg reg);
+inline Reg argReg(size_t index) { return static_cast<Reg>(static_cast<int>(Reg::a0) + static_cast<int>(index)); }
+inline bool isCalleeSaved(Reg reg) { return reg == Reg::s0 || reg == Reg::s1 || (reg >= Reg::s2 && reg <= Reg::s11); }
+
+enum class MOp : uint8_t {
+    // 伪指令 li/mv/neg/seqz/snez 与 lui
+    Li, Lui, Mv, Neg, Seqz, Snez,
+    // R 型
+    Add, Sub, Mul, Div, Rem, Sll, Slt,
+    // I 型
+    Addi, Slti, Andi, Xori, Slli, Srli, Srai,
+    // 访存：lw rd, imm(rs1) / sw rs2, imm(rs1)
+    Lw, Sw,
+    // 控制流：b<cond> rs1, rs2, label / b<cond>z rs1, label
+    Beq, Bne, Blt, Bge, Beqz, Bnez, Bltz, Bgez, Blez, Bgtz, J, Call, Ret,
+    // 标签定义 (不是指令)
+    Label
+};
+
+const char* opName(MOp op);
+// 条件相反的分支 (beq <-> bne、bltz <-> bgez 等)
+MOp invertBranch(MOp op);
+// I 型指令与访存偏移的立即数范围 (12 位有符号)
+inline bool fitsImm12(long long v) { return v >= -2048 && v <= 2047; }
+
+// 一条机器指令。未用到的寄存器为 None；label 为跳转目标、被调函数或标签名，
+// 指向 IR 中的块名、函数名等在生成期间一直存在的字符串，不另外分配。
+// 标签定义的 imm 非 0 时表示先按 2^imm 字节对齐
+struct MachineInstr {
+    MOp op = MOp::Label;
+    Reg rd = Reg::None;
+    Reg rs1 = Reg::None;
+    Reg rs2 = Reg::None;
+    int imm = 0;
+    std::string_view label;
+
+    static MachineInstr rr(MOp op, Reg rd, Reg rs1, Reg rs2);
+    static MachineInstr ri(MOp op, Reg rd, Reg rs1, int imm);
+    static MachineInstr unary(MOp op, Reg rd, Reg rs1);
+    static MachineInstr li(Reg rd, int imm);
+    static MachineInstr load(Reg rd, int offset, Reg base);
+    static MachineInstr store(Reg src, int offset, Reg base);
+    static MachineInstr branch(MOp op, Reg rs1, Reg rs2, std::string_view target);
+    static MachineInstr jump(std::string_view target);
+    static MachineInstr call(std::string_view callee);
+    static MachineInstr ret();
+    static MachineInstr labelDef(std::string_view name, int align = 0);
+
+    bool isLabel() const { return op == MOp::Label; }
+    bool isBranch() const { return op >= MOp::Beq && op <= MOp::Bgtz; }
+    bool isJump() const { return op == MOp::J; }
+    bool hasTarget() const { return isBranch() || isJump(); }
+    bool endsBlock() const { return isBranch() || isJump() || op == MOp::Ret || op == MOp::Call || isLabel(); }
+
+    Reg def() const;            // 写入的寄存器 (call 改写的调用者保存寄存器不计)
+    bool reads(Reg reg) const;
+};
+
+// 一个函数的机器代码，由 AsmPrinter 输出为汇编文本
+struct MachineFunction {
+    std::string_view name;
+    std::vector<MachineInstr> code;
+};
+
+class AsmPrinter {
+public:
+    explicit AsmPrinter(AsmWriter& out) : out(out) {}
+    void printHeader();
+    void print(const MachineFunction& func);
+    void print(const MachineInstr& mi);
+
+private:
+    AsmWriter& out;
+};
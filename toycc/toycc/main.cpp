@@ -3,20 +3,181 @@
 #include "semantic.h"
 #include "codegen.h"
 #include "optimizer.h"  // ȷŻͷļ
+#include "irbuilder.h"
+#include "analysis.h"
+#include "passes.h"
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <chrono>
+#include <algorithm>
+#include <cctype>
+
+// ͳ AST ں׶οģĹϵ
+static size_t countNodes(const std::shared_ptr<Expr>& expr) {
+    if (!expr) return 0;
+    if (auto bin = std::dynamic_pointer_cast<BinaryExpr>(expr)) {
+        return 1 + countNodes(bin->lhs) + countNodes(bin->rhs);
+    }
+    if (auto call = std::dynamic_pointer_cast<CallExpr>(expr)) {
+        size_t n = 1;
+        for (const auto& arg : call->args) n += countNodes(arg);
+        return n;
+    }
+    return 1;
+}
+
+static size_t countNodes(const std::shared_ptr<Stmt>& stmt) {
+    if (!stmt) return 0;
+    if (auto block = std::dynamic_pointer_cast<BlockStmt>(stmt)) {
+        size_t n = 1;
+        for (const auto& s : block->statements) n += countNodes(s);
+        return n;
+    }
+    if (auto ifStmt = std::dynamic_pointer_cast<IfStmt>(stmt)) {
+        return 1 + countNodes(ifStmt->condition) + countNodes(ifStmt->thenStmt) + countNodes(ifStmt->elseStmt);
+    }
+    if (auto whileStmt = std::dynamic_pointer_cast<WhileStmt>(stmt)) {
+        return 1 + countNodes(whileStmt->condition) + countNodes(whileStmt->body);
+    }
+    if (auto decl = std::dynamic_pointer_cast<DeclareStmt>(stmt)) return 1 + countNodes(decl->initVal);
+    if (auto assign = std::dynamic_pointer_cast<AssignStmt>(stmt)) return 1 + countNodes(assign->value);
+    if (auto ret = std::dynamic_pointer_cast<ReturnStmt>(stmt)) return 1 + countNodes(ret->value);
+    if (auto exprStmt = std::dynamic_pointer_cast<ExprStmt>(stmt)) return 1 + countNodes(exprStmt->expr);
+    return 1;
+}
+
+class PhaseTimer {
+public:
+    explicit PhaseTimer(bool enabled) : enabled(enabled), start(std::chrono::steady_clock::now()) {}
+
+    // زϴεĺʱ (΢)
+    double lap(const std::string& phase) {
+        auto now = std::chrono::steady_clock::now();
+        double us = std::chrono::duration<double, std::micro>(now - start).count();
+        start = now;
+        if (enabled) std::cout << "[TIME] " << phase << ": " << us << " us" << std::endl;
+        return us;
+    }
+
+private:
+    bool enabled;
+    std::chrono::steady_clock::time_point start;
+};
+
+// ģϼʱԾڱȽϳϡλ⿪
+template <typename Set>
+static void timeLiveness(Module& module, const std::string& label) {
+    auto start = std::chrono::steady_clock::now();
+    size_t blocks = 0, values = 0;
+    long long visits = 0;
+    for (auto& func : module.functions) {
+        LivenessAnalysis<Set> live(*func);
+        blocks += func->blocks.size();
+        values += live.universe();
+        visits += live.visits();
+    }
+    double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "[TIME] liveness (" << label << "): " << us << " us, " << blocks << " blocks, "
+        << values << " values, " << visits << " block visits" << std::endl;
+}
+
+// Żģظ ()IR ֻŻһΣʱֻ CodeGenظۼԼ 50 ms
+static void timeCodegen(Module& module, RegAllocKind allocKind, bool peephole) {
+    std::ostream sink(nullptr);
+    long long insts = 0, bytes = 0;
+    int runs = 0;
+    double us = 0;
+    while (runs < 3 || us < 50000) {
+        auto start = std::chrono::steady_clock::now();
+        CodeGen codegen(sink, allocKind, peephole, peephole);
+        codegen.generate(module);
+        us += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        insts += codegen.totalStats().instructions;
+        bytes += static_cast<long long>(codegen.bytesWritten());
+        ++runs;
+    }
+    std::cout << "[TIME] codegen throughput: " << (us > 0 ? insts * 1e6 / us : 0.0) << " instructions/s, "
+        << (us > 0 ? bytes / us : 0.0) << " MB/s (" << runs << " runs, " << insts / runs << " instructions, "
+        << bytes / runs << " bytes each)" << std::endl;
+}
+
+static void printUsage() {
+    std::cout << "usage: toyc [input.tc] [-o output.s] [-O0|-O1|-O2|-O3] [--emit-ir] [--dump-analyses] [--time-passes] [--stats] [--regalloc-report] [--frame-report] [--opt-report] [--run] [-funroll-loops] [-funroll-max=N]" << std::endl;
+}
 
 int main(int argc, char* argv[]) {
     std::string filePath;
     std::string outputPath = "output.s";  // Ĭļ
+    bool emitIR = false;
+    bool dumpAnalyses = false;
+    bool timePasses = false;
+    bool printStats = false;
+    bool regallocReport = false;
+    bool frameReport = false;
+    bool optReport = false;
+    bool runProgram = false;
+    int optLevel = 1;
+    bool unrollLoops = false;
+    int unrollMax = 4;   // չ
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-o" && i + 1 < argc) {
+            outputPath = argv[++i];
+        }
+        else if (arg == "--emit-ir") {
+            emitIR = true;
+        }
+        else if (arg == "--dump-analyses") {
+            dumpAnalyses = true;
+        }
+        else if (arg == "--time-passes") {
+            timePasses = true;
+        }
+        else if (arg == "--stats") {
+            printStats = true;
+        }
+        else if (arg == "--regalloc-report") {
+            regallocReport = true;
+        }
+        else if (arg == "--frame-report") {
+            frameReport = true;
+        }
+        else if (arg == "--opt-report") {
+            optReport = true;
+        }
+        else if (arg == "--run") {
+            runProgram = true;
+        }
+        else if (arg == "-funroll-loops") {
+            unrollLoops = true;
+        }
+        else if (arg.rfind("-funroll-max=", 0) == 0 && arg.size() > 13 && std::isdigit(static_cast<unsigned char>(arg[13]))) {
+            unrollMax = std::max(1, std::stoi(arg.substr(13)));
+        }
+        else if (arg.size() == 3 && arg[0] == '-' && arg[1] == 'O' && arg[2] >= '0' && arg[2] <= '3') {
+            optLevel = arg[2] - '0';
+        }
+        else if (arg == "-h" || arg == "--help") {
+            printUsage();
+            return 0;
+        }
+        else if (!arg.empty() && arg[0] == '-') {
+            std::cerr << "[ERROR] Unknown option: " << arg << std::endl;
+            printUsage();
+            return 1;
+        }
+        else {
+            filePath = arg;
+        }
+    }
 
-    if (argc < 2) {
+    if (filePath.empty()) {
         filePath = "test1.tc";
         std::cout << "[INFO] No input file specified. Using default: " << filePath << std::endl;
     }
     else {
-        filePath = argv[1];
         std::cout << "[INFO] Using input file: " << filePath << std::endl;
     }
 
@@ -31,16 +192,65 @@ int main(int argc, char* argv[]) {
     std::string sourceCode = buffer.str();
 
     try {
+        PhaseTimer timer(timePasses);
+
         Lexer lexer(sourceCode);
         Parser parser(lexer);
         auto ast = parser.parseCompUnit();
+        timer.lap("parse");
 
         SemanticAnalyzer semanticAnalyzer;
         semanticAnalyzer.analyze(ast);
+        timer.lap("semantic");
 
         // ӦŻ
         Optimizer optimizer;
         optimizer.optimize(ast);
+        timer.lap("ast optimize");
+
+        // AST -> SSA IR
+        IRBuilder irBuilder;
+        auto module = irBuilder.build(ast);
+        double irTime = timer.lap("ir build");
+
+        if (timePasses) {
+            size_t nodes = 0, insts = 0, blocks = 0;
+            for (const auto& func : ast) nodes += 1 + countNodes(func->body);
+            for (const auto& func : module->functions) {
+                insts += func->instructionCount();
+                blocks += func->blocks.size();
+            }
+            std::cout << "[TIME] ir build cost: " << nodes << " AST nodes -> " << blocks << " blocks, "
+                << insts << " instructions, " << (nodes ? irTime * 1000.0 / nodes : 0.0) << " ns/node" << std::endl;
+
+            timeLiveness<BitVector>(*module, "dense");
+            timeLiveness<SparseBitVector>(*module, "sparse");
+            timer.lap("dataflow bench");
+        }
+
+        // IR Ż-O0 ʱѭչֻ -O2 Ҹ -funroll-loops ʱ
+        PassPipeline pipeline(optLevel, unrollLoops ? unrollMax : 0);
+        pipeline.run(*module);
+        timer.lap("ir optimize");
+        if (optReport) {
+            for (const auto& pass : pipeline.report()) {
+                std::cout << "[OPT] " << pass.pass << ":";
+                for (size_t i = 0; i < pass.counters.size(); ++i) {
+                    std::cout << (i ? ", " : " ") << pass.counters[i].second << " " << pass.counters[i].first;
+                }
+                std::cout << std::endl;
+            }
+        }
+
+        if (emitIR) {
+            printModule(std::cout, *module);
+        }
+        if (dumpAnalyses) {
+            for (auto& func : module->functions) {
+                AnalysisManager am(*func);
+                printAnalyses(std::cout, am);
+            }
+        }
 
         std::ofstream fout(outputPath);
         if (!fout) {
@@ -48,9 +258,79 @@ int main(int argc, char* argv[]) {
             return 1;
         }
 
-        CodeGen codegen(fout);
-        codegen.generate(ast);
+        // -O3 ͼɫ
+        // -O0 Ż鲼
+        RegAllocKind allocKind = optLevel >= 3 ? RegAllocKind::GraphColoring : RegAllocKind::LinearScan;
+        CodeGen codegen(fout, allocKind, optLevel >= 1, optLevel >= 1);
+        Simulator simulator;
+        if (runProgram) codegen.setSimulator(&simulator);
+        codegen.generate(*module);
         fout.close();
+        timer.lap("codegen");
+
+        if (runProgram) {
+            // ִɵĴ룬涯ָ̬֧ת
+            int result = simulator.run();
+            const auto& st = simulator.stats();
+            std::cout << "[RUN] main returned " << result << ": " << st.instructions << " instructions, " << st.cycles << " cycles, "
+                << st.takenBranches << "/" << st.branches << " branches taken, " << st.jumps
+                << " jumps/calls/returns" << std::endl;
+            timer.lap("run");
+        }
+
+        if (timePasses) {
+            timeCodegen(*module, allocKind, optLevel >= 1);
+            timer.lap("codegen bench");
+        }
+
+        if (regallocReport) {
+            // ַһ ()Ա뿽
+            std::ostringstream linearOut, coloringOut;
+            CodeGen linear(linearOut, RegAllocKind::LinearScan);
+            CodeGen coloring(coloringOut, RegAllocKind::GraphColoring);
+            linear.generate(*module);
+            coloring.generate(*module);
+            auto describe = [](const CodeGen::Stats& st) {
+                return std::to_string(st.spilledValues) + " spills, " + std::to_string(st.moves) + " moves, "
+                    + std::to_string(st.loads) + " loads, " + std::to_string(st.stores) + " stores";
+            };
+            for (size_t i = 0; i < linear.functionStats().size(); ++i) {
+                std::cout << "[REGALLOC] " << linear.functionStats()[i].first
+                    << ": linear-scan " << describe(linear.functionStats()[i].second)
+                    << " | graph-coloring " << describe(coloring.functionStats()[i].second) << std::endl;
+            }
+            std::cout << "[REGALLOC] total: linear-scan " << describe(linear.totalStats())
+                << " | graph-coloring " << describe(coloring.totalStats()) << std::endl;
+        }
+
+        if (frameReport) {
+            // ջ۰ڹú֡СÿֵռһʱԱ
+            auto describe = [](const CodeGen::Stats& st) {
+                return std::to_string(st.frameSize) + " bytes (" + std::to_string(st.stackSlots) + " slots for "
+                    + std::to_string(st.stackValues) + " values, " + std::to_string(st.unsharedFrameSize)
+                    + " bytes without sharing)";
+            };
+            for (const auto& [name, st] : codegen.functionStats()) {
+                std::cout << "[FRAME] " << name << ": " << describe(st) << std::endl;
+            }
+            std::cout << "[FRAME] total: " << describe(codegen.totalStats()) << std::endl;
+        }
+
+        if (printStats) {
+            for (const auto& [name, st] : codegen.functionStats()) {
+                std::cout << "[STATS] " << name << ": " << st.instructions << " instructions, " << st.loads << " loads, " << st.stores << " stores, "
+                    << st.moves << " moves, " << st.spilledValues << " spilled values" << std::endl;
+            }
+            const auto& hits = codegen.peepholeStats().hits();
+            std::cout << "[STATS] peephole:";
+            for (int r = 0; r < PeepholeOptimizer::NumRules; ++r) {
+                std::cout << (r ? ", " : " ") << PeepholeOptimizer::ruleName(static_cast<PeepholeOptimizer::Rule>(r)) << " " << hits[r];
+            }
+            std::cout << std::endl;
+            const auto& st = codegen.totalStats();
+            std::cout << "[STATS] total: " << st.instructions << " instructions, " << st.loads << " loads, " << st.stores << " stores, "
+                << st.moves << " moves, " << st.spilledValues << " spilled values" << std::endl;
+        }
 
         std::cout << "[SUCCESS] RISC-V assembly generated: " << outputPath << std::endl;
         return 0;
@@ -60,4 +340,4 @@ int main(int argc, char* argv[]) {
         std::cerr << "[FAILURE] Compilation failed: " << ex.what() << std::endl;
         return 1;
     }
-}
\ No newline at end of file
+}
@@ -8,17 +8,12 @@ void Optimizer::optimize(std::vector<std::shared_ptr<FuncDef>>& funcs) {
     }
 }
 
+// ֻ۵泣ɵıʽĳ (֧ѭ)  IR ϵ SCCP 
 void Optimizer::optimizeFunc(const std::shared_ptr<FuncDef>& func) {
-    std::unordered_map<std::string, int> constVars;
-    optimizeBlock(func->body, constVars);
+    optimizeBlock(func->body);
 }
 
-void Optimizer::optimizeBlock(const std::shared_ptr<BlockStmt>& block,
-    std::unordered_map<std::string, int>& constVars,
-    bool inLoop) {
-    // Ƶǰĳ
-    std::unordered_map<std::string, int> currentConstVars = constVars;
-
+void Optimizer::optimizeBlock(const std::shared_ptr<BlockStmt>& block, bool inLoop) {
     for (auto it = block->statements.begin(); it != block->statements.end();) {
         auto& stmt = *it;
 
@@ -32,73 +27,36 @@ void Optimizer::optimizeBlock(const std::shared_ptr<BlockStmt>& block,
         // Ż
         if (auto decl = std::dynamic_pointer_cast<DeclareStmt>(stmt)) {
             // Żʼʽ
-            std::set<std::string> loopVars;
-            decl->initVal = optimizeExpr(decl->initVal, currentConstVars, loopVars);
-
-            // ǳ볣
-            if (auto num = std::dynamic_pointer_cast<NumberExpr>(decl->initVal)) {
-                currentConstVars[decl->varName] = num->value;
-            }
-            else {
-                currentConstVars.erase(decl->varName);
-            }
+            decl->initVal = optimizeExpr(decl->initVal);
             ++it;
         }
         // ֵŻ
         else if (auto assign = std::dynamic_pointer_cast<AssignStmt>(stmt)) {
             // Żֵʽ
-            std::set<std::string> loopVars;
-            assign->value = optimizeExpr(assign->value, currentConstVars, loopVars);
+            assign->value = optimizeExpr(assign->value);
 
             // ǿ
             if (auto bin = std::dynamic_pointer_cast<BinaryExpr>(assign->value)) {
                 reduceStrength(bin);
             }
-
-            // ӳƳֵѸı䣩
-            currentConstVars.erase(assign->varName);
             ++it;
         }
         // ѭŻ
         else if (auto whileStmt = std::dynamic_pointer_cast<WhileStmt>(stmt)) {
-            // ռѭ޸ĵı
-            std::set<std::string> modifiedVars;
-            collectModifiedVars(whileStmt->body, modifiedVars);
-
-            // ӳƳܱ޸ĵı
-            for (const auto& var : modifiedVars) {
-                currentConstVars.erase(var);
-            }
-
-            // ռѭеı
-            std::set<std::string> condVars;
-            collectVarsInExpr(whileStmt->condition, condVars);
-
-            // ϲ
-            std::set<std::string> loopVars;
-            loopVars.insert(modifiedVars.begin(), modifiedVars.end());
-            loopVars.insert(condVars.begin(), condVars.end());
-
-            // Żʽ
-            std::set<std::string> loopInvariants;
-            whileStmt->condition = optimizeExpr(whileStmt->condition, currentConstVars, loopInvariants);
-
-            // ѭǳʱųʽ
-            if (!std::dynamic_pointer_cast<NumberExpr>(whileStmt->condition)) {
-                hoistLoopInvariants(whileStmt, currentConstVars);
-            }
+            // Żʽ (ѭ IR )
+            whileStmt->condition = optimizeExpr(whileStmt->condition);
 
             // ݹŻѭ
             bool oldInLoop = inLoop;
             inLoop = true;
             if (auto bodyBlock = std::dynamic_pointer_cast<BlockStmt>(whileStmt->body)) {
-                optimizeBlock(bodyBlock, currentConstVars, true);
+                optimizeBlock(bodyBlock, true);
             }
             else {
                 // ǿתΪ
                 auto newBody = std::make_shared<BlockStmt>();
                 newBody->statements.push_back(whileStmt->body);
-                optimizeBlock(newBody, currentConstVars, true);
+                optimizeBlock(newBody, true);
                 whileStmt->body = newBody;
             }
             inLoop = oldInLoop;
@@ -108,8 +66,7 @@ void Optimizer::optimizeBlock(const std::shared_ptr<BlockStmt>& block,
         else {
             if (auto ifStmt = std::dynamic_pointer_cast<IfStmt>(stmt)) {
                 // Żʽ
-                std::set<std::string> loopVars;
-                ifStmt->condition = optimizeExpr(ifStmt->condition, currentConstVars, loopVars);
+                ifStmt->condition = optimizeExpr(ifStmt->condition);
 
                 // Ϊ
                 if (auto num = std::dynamic_pointer_cast<NumberExpr>(ifStmt->condition)) {
@@ -130,8 +87,7 @@ void Optimizer::optimizeBlock(const std::shared_ptr<BlockStmt>& block,
             }
             else if (auto exprStmt = std::dynamic_pointer_cast<ExprStmt>(stmt)) {
                 // Żʽ
-                std::set<std::string> loopVars;
-                exprStmt->expr = optimizeExpr(exprStmt->expr, currentConstVars, loopVars);
+                exprStmt->expr = optimizeExpr(exprStmt->expr);
 
                 // ʽǳɾ
                 if (std::dynamic_pointer_cast<NumberExpr>(exprStmt->expr)) {
@@ -150,31 +106,19 @@ void Optimizer::optimizeBlock(const std::shared_ptr<BlockStmt>& block,
     if (block) {
         for (auto& stmt : block->statements) {
             if (auto subBlock = std::dynamic_pointer_cast<BlockStmt>(stmt)) {
-                optimizeBlock(subBlock, constVars, inLoop);
+                optimizeBlock(subBlock, inLoop);
             }
         }
     }
 }
 
-std::shared_ptr<Expr> Optimizer::optimizeExpr(const std::shared_ptr<Expr>& expr,
-    std::unordered_map<std::string, int>& constVars,
-    std::set<std::string>& loopInvariants) {
+std::shared_ptr<Expr> Optimizer::optimizeExpr(const std::shared_ptr<Expr>& expr) {
     if (!expr) return expr;
 
-    // 滻Ϊ
-    if (auto var = std::dynamic_pointer_cast<VariableExpr>(expr)) {
-        auto it = constVars.find(var->name);
-        if (it != constVars.end()) {
-            return std::make_shared<NumberExpr>(it->second);
-        }
-        loopInvariants.insert(var->name);
-        return var;
-    }
-
     // ԪʽŻ
     if (auto bin = std::dynamic_pointer_cast<BinaryExpr>(expr)) {
-        bin->lhs = optimizeExpr(bin->lhs, constVars, loopInvariants);
-        bin->rhs = optimizeExpr(bin->rhs, constVars, loopInvariants);
+        bin->lhs = optimizeExpr(bin->lhs);
+        bin->rhs = optimizeExpr(bin->rhs);
 
         // ۵
         if (auto lhsNum = std::dynamic_pointer_cast<NumberExpr>(bin->lhs)) {
@@ -207,7 +151,7 @@ std::shared_ptr<Expr> Optimizer::optimizeExpr(const std::shared_ptr<Expr>& expr,
     // Ż
     if (auto call = std::dynamic_pointer_cast<CallExpr>(expr)) {
         for (auto& arg : call->args) {
-            arg = optimizeExpr(arg, constVars, loopInvariants);
+            arg = optimizeExpr(arg);
         }
         return call;
     }
@@ -215,95 +159,6 @@ std::shared_ptr<Expr> Optimizer::optimizeExpr(const std::shared_ptr<Expr>& expr,
     return expr;
 }
 
-void Optimizer::hoistLoopInvariants(const std::shared_ptr<WhileStmt>& whileStmt,
-    const std::unordered_map<std::string, int>& constVars) {
-    if (!whileStmt->body) return;
-
-    // ռѭпܱ޸ĵı
-    std::set<std::string> modifiedVars;
-    collectModifiedVars(whileStmt->body, modifiedVars);
-
-    // ռѭеı
-    std::set<std::string> condVars;
-    collectVarsInExpr(whileStmt->condition, condVars);
-
-    // ϲ
-    std::set<std::string> loopVars;
-    loopVars.insert(modifiedVars.begin(), modifiedVars.end());
-    loopVars.insert(condVars.begin(), condVars.end());
-
-    // ȷѭǿ
-    auto bodyBlock = std::dynamic_pointer_cast<BlockStmt>(whileStmt->body);
-    if (!bodyBlock) {
-        // ѭ岻ǿ䣬תΪ
-        auto newBody = std::make_shared<BlockStmt>();
-        newBody->statements.push_back(whileStmt->body);
-        whileStmt->body = newBody;
-        bodyBlock = newBody;
-    }
-
-    // ȡѭʽ
-    auto& stmts = bodyBlock->statements;
-    std::vector<std::shared_ptr<Stmt>> hoistedStmts;
-
-    for (auto it = stmts.begin(); it != stmts.end(); ) {
-        bool hoist = false;
-
-        if (auto assign = std::dynamic_pointer_cast<AssignStmt>(*it)) {
-            // 鸳ֵҲǷѭʽ
-            if (isLoopInvariant(assign->value, loopVars)) {
-                hoist = true;
-            }
-        }
-        else if (auto decl = std::dynamic_pointer_cast<DeclareStmt>(*it)) {
-            // ʼʽǷѭʽ
-            if (isLoopInvariant(decl->initVal, loopVars)) {
-                hoist = true;
-            }
-        }
-
-        if (hoist) {
-            // ӵб
-            hoistedStmts.push_back(*it);
-            it = stmts.erase(it);
-        }
-        else {
-            ++it;
-        }
-    }
-
-    // 䣬µѭ
-    if (!hoistedStmts.empty()) {
-        // µѭ壨ԭѭ壩
-        auto newBody = std::make_shared<BlockStmt>();
-        newBody->statements = hoistedStmts;
-        newBody->statements.push_back(bodyBlock);
-        whileStmt->body = newBody;
-    }
-}
-
-bool Optimizer::isLoopInvariant(const std::shared_ptr<Expr>& expr,
-    const std::set<std::string>& loopVars) const {
-    if (!expr) return true;
-
-    if (auto var = std::dynamic_pointer_cast<VariableExpr>(expr)) {
-        // ʽѭѭʽ
-        return loopVars.find(var->name) == loopVars.end();
-    }
-
-    if (auto bin = std::dynamic_pointer_cast<BinaryExpr>(expr)) {
-        return isLoopInvariant(bin->lhs, loopVars) &&
-            isLoopInvariant(bin->rhs, loopVars);
-    }
-
-    if (auto call = std::dynamic_pointer_cast<CallExpr>(expr)) {
-        // 躯òѭʽزԣ
-        return false;
-    }
-
-    return true;
-}
-
 void Optimizer::eliminateDeadCode(const std::shared_ptr<BlockStmt>& block) {
     if (!block) return;
 
@@ -373,47 +228,3 @@ void Optimizer::reduceStrength(const std::shared_ptr<BinaryExpr>& bin) {
         }
     }
 }
-
-void Optimizer::collectModifiedVars(const std::shared_ptr<Stmt>& stmt,
-    std::set<std::string>& modifiedVars) {
-    if (!stmt) return;
-
-    if (auto block = std::dynamic_pointer_cast<BlockStmt>(stmt)) {
-        for (auto& s : block->statements) {
-            collectModifiedVars(s, modifiedVars);
-        }
-    }
-    else if (auto assign = std::dynamic_pointer_cast<AssignStmt>(stmt)) {
-        modifiedVars.insert(assign->varName);
-    }
-    else if (auto decl = std::dynamic_pointer_cast<DeclareStmt>(stmt)) {
-        modifiedVars.insert(decl->varName);
-    }
-    else if (auto ifStmt = std::dynamic_pointer_cast<IfStmt>(stmt)) {
-        collectModifiedVars(ifStmt->thenStmt, modifiedVars);
-        if (ifStmt->elseStmt) {
-            collectModifiedVars(ifStmt->elseStmt, modifiedVars);
-        }
-    }
-    else if (auto whileStmt = std::dynamic_pointer_cast<WhileStmt>(stmt)) {
-        collectModifiedVars(whileStmt->body, modifiedVars);
-    }
-}
-
-void Optimizer::collectVarsInExpr(const std::shared_ptr<Expr>& expr,
-    std::set<std::string>& vars) {
-    if (!expr) return;
-
-    if (auto var = std::dynamic_pointer_cast<VariableExpr>(expr)) {
-        vars.insert(var->name);
-    }
-    else if (auto bin = std::dynamic_pointer_cast<BinaryExpr>(expr)) {
-        collectVarsInExpr(bin->lhs, vars);
-        collectVarsInExpr(bin->rhs, vars);
-    }
-    else if (auto call = std::dynamic_pointer_cast<CallExpr>(expr)) {
-        for (const auto& arg : call->args) {
-            collectVarsInExpr(arg, vars);
-        }
-    }
-}
\ No newline at end of file
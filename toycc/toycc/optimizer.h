@@ -12,26 +12,10 @@ public:
 
 private:
     void optimizeFunc(const std::shared_ptr<FuncDef>& func);
-    void optimizeBlock(const std::shared_ptr<BlockStmt>& block,
-        std::unordered_map<std::string, int>& constVars,
-        bool inLoop = false);
+    void optimizeBlock(const std::shared_ptr<BlockStmt>& block, bool inLoop = false);
 
-    std::shared_ptr<Expr> optimizeExpr(const std::shared_ptr<Expr>& expr,
-        std::unordered_map<std::string, int>& constVars,
-        std::set<std::string>& loopInvariants);
-
-    void hoistLoopInvariants(const std::shared_ptr<WhileStmt>& whileStmt,
-        const std::unordered_map<std::string, int>& constVars);
+    std::shared_ptr<Expr> optimizeExpr(const std::shared_ptr<Expr>& expr);
 
     void eliminateDeadCode(const std::shared_ptr<BlockStmt>& block);
     void reduceStrength(const std::shared_ptr<BinaryExpr>& bin);
-
-    bool isLoopInvariant(const std::shared_ptr<Expr>& expr,
-        const std::set<std::string>& loopVars) const;
-
-    void collectModifiedVars(const std::shared_ptr<Stmt>& stmt,
-        std::set<std::string>& modifiedVars);
-
-    void collectVarsInExpr(const std::shared_ptr<Expr>& expr,
-        std::set<std::string>& vars);
 };
\ No newline at end of file
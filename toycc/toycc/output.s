@@ -1,62 +1,48 @@
     .text
     .globl main
     main:
-    addi sp, sp, -256
-    li t0, 0
-    sw t0, -4(sp)
-    li t1, 0
-    sw t1, -8(sp)
-    loop_0:
-    lw t3, -8(sp)
-    li t4, 10
-    slt t2, t3, t4
-    beqz t2, endloop_1
-    lw t6, -8(sp)
-    li t0, 5
-    sub t5, t6, t0
-    seqz t5, t5
-    beqz t5, else_2
-    lw t2, -8(sp)
-    li t3, 1
-    add t1, t2, t3
-    sw t1, -8(sp)
-    j loop_0
-    j endif_3
-    else_2:
-    endif_3:
-    lw t5, -8(sp)
-    li t6, 8
-    sub t4, t5, t6
-    seqz t4, t4
-    beqz t4, else_4
-    j endloop_1
-    j endif_5
-    else_4:
-    endif_5:
-    lw t1, -4(sp)
-    lw t3, -8(sp)
-    mv a0, t3
-    li t4, 1
-    mv a1, t4
+    addi sp, sp, -16
+    sw s0, 0(sp)
+    sw s1, 4(sp)
+    sw ra, 8(sp)
+    li s0, 0
+    li s1, 0
+    .p2align 4
+    body_3:
+    li t1, 5
+    bne s1, t1, endif_6
+    then_5:
+    addi t3, s1, 1
+    li t1, 10
+    bge t3, t1, endloop_4
+    split_9:
+    mv s1, t3
+    j body_3
+    endif_6:
+    li t1, 8
+    beq s1, t1, then_7
+    endif_8:
+    mv a0, s1
+    li a1, 1
     call add
-    mv t2, a0
-    add t0, t1, t2
-    sw t0, -4(sp)
-    lw t6, -8(sp)
-    li t0, 1
-    add t5, t6, t0
-    sw t5, -8(sp)
-    j loop_0
-    endloop_1:
-    lw t1, -4(sp)
-    mv a0, t1
-    addi sp, sp, 256
+    add t3, s0, a0
+    addi s1, s1, 1
+    li t1, 10
+    bge s1, t1, split_12
+    split_10:
+    mv s0, t3
+    j body_3
+    then_7:
+    endloop_4:
+    mv a0, s0
+    lw s0, 0(sp)
+    lw s1, 4(sp)
+    lw ra, 8(sp)
+    addi sp, sp, 16
     ret
+    split_12:
+    mv s0, t3
+    j endloop_4
     add:
-    addi sp, sp, -256
-    lw t3, -4(sp)
-    lw t4, -8(sp)
-    add t2, t3, t4
-    mv a0, t2
-    addi sp, sp, 256
+    add a0, a0, a1
     ret
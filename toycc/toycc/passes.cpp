@@ -0,0 +1,144 @@
+#include "passes.h"
+#include "sccp.h"
+#include "gvn.h"
+#include "dce.h"
+#include "licm.h"
+#include "pre.h"
+#include "rotate.h"
+#include "ivopt.h"
+#include "unroll.h"
+#include "unswitch.h"
+#include "loopsplit.h"
+
+void PassCounters::add(const std::string& name, int n) {
+    for (auto& [key, value] : counters) {
+        if (key == name) {
+            value += n;
+            return;
+        }
+    }
+    counters.emplace_back(name, n);
+}
+
+PassCounters& PassPipeline::counters(const std::string& pass) {
+    for (auto& p : passes) {
+        if (p.pass == pass) return p;
+    }
+    passes.push_back({ pass, {} });
+    return passes.back();
+}
+
+void PassPipeline::run(Module& module) {
+    if (optLevel < 1) return;
+    if (optLevel >= 2) pure = findPureFunctions(module);
+    for (auto& func : module.functions) {
+        AnalysisManager am(*func);
+        rotate(*func, am);
+        sccp(*func, am);
+        gvn(*func, am);
+        dce(*func, am);
+        if (optLevel < 2) continue;
+        // 外提、部分冗余消除与强度削弱后可能出现重复的表达式、平凡 phi 和不再需要的计数器，
+        // 再做一遍值编号与死代码删除
+        licm(*func, am);
+        // 外提后不变的条件都在循环外算出，此时识别以它为条件的分支
+        if (optLevel >= 3) unswitch(*func, am);
+        split(*func, am);
+        pre(*func, am);
+        ivopt(*func, am);
+        if (unrollFactor > 0) {
+            // 完全展开后各份中的计数器成为常量，交给 sccp 折叠比较与分支
+            unroll(*func, am);
+            sccp(*func, am);
+        }
+        gvn(*func, am);
+        dce(*func, am);
+    }
+}
+
+void PassPipeline::rotate(Function& func, AnalysisManager& am) {
+    RotateStats stats;
+    am.invalidate(runLoopRotate(func, am, stats));
+    auto& c = counters("rotate");
+    c.add("loops", stats.loops);
+    c.add("duplicated", stats.duplicated);
+}
+
+void PassPipeline::sccp(Function& func, AnalysisManager& am) {
+    SCCPStats stats;
+    am.invalidate(runSCCP(func, stats));
+    auto& c = counters("sccp");
+    c.add("constants", stats.constants);
+    c.add("branches", stats.foldedBranches);
+    c.add("blocks", stats.removedBlocks);
+}
+
+void PassPipeline::gvn(Function& func, AnalysisManager& am) {
+    GVNStats stats;
+    am.invalidate(runGVN(func, am, stats));
+    auto& c = counters("gvn");
+    c.add("expressions", stats.expressions);
+    c.add("copies", stats.copies);
+    c.add("phis", stats.phis);
+}
+
+void PassPipeline::dce(Function& func, AnalysisManager& am) {
+    DCEStats stats;
+    am.invalidate(runDCE(func, stats));
+    auto& c = counters("dce");
+    c.add("instructions", stats.instructions);
+    c.add("phis", stats.phis);
+}
+
+void PassPipeline::licm(Function& func, AnalysisManager& am) {
+    LICMStats stats;
+    am.invalidate(runLICM(func, am, pure, stats));
+    auto& c = counters("licm");
+    c.add("instructions", stats.instructions);
+    c.add("calls", stats.calls);
+    c.add("loops", stats.loops);
+}
+
+void PassPipeline::pre(Function& func, AnalysisManager& am) {
+    PREStats stats;
+    am.invalidate(runPRE(func, stats));
+    auto& c = counters("pre");
+    c.add("inserted", stats.inserted);
+    c.add("replaced", stats.replaced);
+}
+
+void PassPipeline::ivopt(Function& func, AnalysisManager& am) {
+    IVStats stats;
+    am.invalidate(runIVOpt(func, am, stats));
+    auto& c = counters("ivopt");
+    c.add("reduced", stats.reduced);
+    c.add("tests", stats.tests);
+    c.add("removed", stats.removed);
+}
+
+void PassPipeline::unroll(Function& func, AnalysisManager& am) {
+    UnrollStats stats;
+    am.invalidate(runLoopUnroll(func, am, unrollFactor, stats));
+    auto& c = counters("unroll");
+    c.add("full", stats.full);
+    c.add("partial", stats.partial);
+    c.add("copies", stats.copies);
+}
+
+void PassPipeline::unswitch(Function& func, AnalysisManager& am) {
+    UnswitchStats stats;
+    am.invalidate(runLoopUnswitch(func, am, stats));
+    auto& c = counters("unswitch");
+    c.add("branches", stats.branches);
+    c.add("cloned", stats.cloned);
+}
+
+void PassPipeline::split(Function& func, AnalysisManager& am) {
+    LoopSplitStats stats;
+    am.invalidate(runLoopSplit(func, am, stats));
+    auto& c = counters("split");
+    c.add("loops", stats.loops);
+    c.add("segments", stats.segments);
+    c.add("peeled", stats.peeled);
+    c.add("folded", stats.folded);
+}
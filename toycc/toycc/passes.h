@@ -0,0 +1,48 @@
+#pragma once
+#include "ir.h"
+#include "analysis.h"
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+// 一个变换在整个模块上的计数，如 sccp 的 "constants" 与 "branches"
+struct PassCounters {
+    std::string pass;
+    std::vector<std::pair<std::string, int>> counters;
+
+    void add(const std::string& name, int n);
+};
+
+// 按 -O 级别组织的 IR 优化流水线：逐函数依次运行各变换，共用一个 AnalysisManager，
+// 变换返回的 Preserved 决定哪些分析需要重算
+//   -O0  不做 IR 优化
+//   -O1  rotate, sccp, gvn, dce
+//   -O2+ 再做 licm, split, pre, ivopt，之后重复 gvn, dce
+//   -O3  另在 licm 之后做 unswitch
+// unrollFactor 非 0 时 (-funroll-loops) 在 ivopt 之后展开循环，倍数不超过它，并在重复的 gvn 前先做 sccp
+class PassPipeline {
+public:
+    explicit PassPipeline(int optLevel, int unrollFactor = 0) : optLevel(optLevel), unrollFactor(unrollFactor) {}
+
+    void run(Module& module);
+    const std::vector<PassCounters>& report() const { return passes; }
+
+private:
+    int optLevel;
+    int unrollFactor;
+    std::vector<PassCounters> passes;
+    std::unordered_set<std::string> pure;   // 纯函数，调用可以外提
+
+    PassCounters& counters(const std::string& pass);
+    void rotate(Function& func, AnalysisManager& am);
+    void sccp(Function& func, AnalysisManager& am);
+    void gvn(Function& func, AnalysisManager& am);
+    void dce(Function& func, AnalysisManager& am);
+    void licm(Function& func, AnalysisManager& am);
+    void unswitch(Function& func, AnalysisManager& am);
+    void split(Function& func, AnalysisManager& am);
+    void pre(Function& func, AnalysisManager& am);
+    void ivopt(Function& func, AnalysisManager& am);
+    void unroll(Function& func, AnalysisManager& am);
+};
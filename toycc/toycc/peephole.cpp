@@ -0,0 +1,292 @@
+#include "peephole.h"
+
+const char* PeepholeOptimizer::ruleName(Rule rule) {
+    static const char* names[NumRules] = {
+        "jump-to-next", "jump-threading", "branch-over-jump", "backward-branch", "dead-code",
+        "load-forwarding", "redundant-move", "immediate-fold"
+    };
+    return names[rule];
+}
+
+// ---------------- 辅助 ----------------
+
+static bool isScratch(Reg reg) {
+    return reg == Reg::t0 || reg == Reg::t1 || reg == Reg::t2;
+}
+
+// ---------------- 驱动 ----------------
+
+void PeepholeOptimizer::run(std::vector<MachineInstr>& lines) {
+    code = &lines;
+    // 每轮自前向后应用全部规则，改写可能暴露新的机会 (如删去死代码后跳转落到下一行)；
+    // 轮数设上限以防跳转成环时反复改写
+    for (int round = 0; round < 16; ++round) {
+        removed.assign(lines.size(), false);
+        countLabelRefs();
+        bool changed = false;
+        for (size_t i = 0; i < lines.size(); ++i) {
+            using Apply = bool (PeepholeOptimizer::*)(size_t);
+            static const std::pair<Rule, Apply> rules[] = {
+                { RedundantMove, &PeepholeOptimizer::redundantMove },
+                { ImmediateFold, &PeepholeOptimizer::immediateFold },
+                { LoadForwarding, &PeepholeOptimizer::loadForwarding },
+                { JumpThreading, &PeepholeOptimizer::jumpThreading },
+                { BranchOverJump, &PeepholeOptimizer::branchOverJump },
+                { BackwardBranch, &PeepholeOptimizer::backwardBranch },
+                { JumpToNext, &PeepholeOptimizer::jumpToNext },
+                { DeadCode, &PeepholeOptimizer::deadCode },
+            };
+            for (auto& [rule, apply] : rules) {
+                if (removed[i] || lines[i].isLabel()) break;
+                if ((this->*apply)(i)) {
+                    ++ruleHits[rule];
+                    changed = true;
+                }
+            }
+        }
+
+        size_t out = 0;
+        for (size_t i = 0; i < lines.size(); ++i) {
+            if (removed[i]) continue;
+            if (out != i) lines[out] = lines[i];
+            ++out;
+        }
+        lines.resize(out);
+        if (!changed) break;
+    }
+    code = nullptr;
+}
+
+void PeepholeOptimizer::countLabelRefs() {
+    labelRefs.clear();
+    labelIndex.clear();
+    for (size_t i = 0; i < code->size(); ++i) {
+        const MachineInstr& l = (*code)[i];
+        if (l.hasTarget()) ++labelRefs[l.label];
+        if (l.isLabel()) labelIndex[l.label] = i;
+    }
+}
+
+size_t PeepholeOptimizer::nextLine(size_t i) const {
+    for (++i; i < code->size() && removed[i]; ++i) {}
+    return i;
+}
+
+size_t PeepholeOptimizer::nextInst(size_t i) const {
+    for (i = nextLine(i); i < code->size() && (*code)[i].isLabel(); i = nextLine(i)) {}
+    return i;
+}
+
+size_t PeepholeOptimizer::targetOf(std::string_view label) const {
+    auto it = labelIndex.find(label);
+    return it == labelIndex.end() ? code->size() : nextInst(it->second);
+}
+
+// 寄存器在下一次被读之前是否已被改写。到达基本块边界时只有临时寄存器可确定已死；
+// i 本身是分支或跳转时顺序往下看到的只是落空路径，同样只认临时寄存器
+bool PeepholeOptimizer::deadAfter(size_t i, Reg reg) const {
+    if ((*code)[i].endsBlock()) return isScratch(reg);
+    for (size_t k = nextLine(i); k < code->size(); k = nextLine(k)) {
+        const MachineInstr& l = (*code)[k];
+        if (l.reads(reg)) return false;
+        if (l.endsBlock()) return isScratch(reg);
+        if (l.def() == reg) return true;
+    }
+    return isScratch(reg);
+}
+
+void PeepholeOptimizer::remove(size_t i) {
+    MachineInstr& l = (*code)[i];
+    if (l.hasTarget()) --labelRefs[l.label];
+    removed[i] = true;
+}
+
+void PeepholeOptimizer::retarget(MachineInstr& jump, std::string_view label) {
+    --labelRefs[jump.label];
+    jump.label = label;
+    ++labelRefs[label];
+}
+
+// ---------------- 规则 ----------------
+
+bool PeepholeOptimizer::jumpToNext(size_t i) {
+    MachineInstr& l = (*code)[i];
+    if (!l.hasTarget()) return false;
+    for (size_t k = nextLine(i); k < code->size() && (*code)[k].isLabel(); k = nextLine(k)) {
+        if ((*code)[k].label == l.label) {
+            remove(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool PeepholeOptimizer::jumpThreading(size_t i) {
+    MachineInstr& l = (*code)[i];
+    if (!l.hasTarget()) return false;
+    size_t t = targetOf(l.label);
+    if (t >= code->size()) return false;
+    const MachineInstr& target = (*code)[t];
+    if (target.isJump() && target.label != l.label) {
+        retarget(l, target.label);
+        return true;
+    }
+    if (l.isJump() && target.op == MOp::Ret) {
+        --labelRefs[l.label];
+        l = target;
+        return true;
+    }
+    return false;
+}
+
+bool PeepholeOptimizer::branchOverJump(size_t i) {
+    MachineInstr& branch = (*code)[i];
+    if (!branch.isBranch()) return false;
+    // 分支与 j 之间只能有未被引用的标签 (仅由落入到达)
+    std::vector<size_t> between;
+    size_t j = nextLine(i);
+    for (; j < code->size() && (*code)[j].isLabel(); j = nextLine(j)) {
+        if (labelRefs[(*code)[j].label] > 0) return false;
+        between.push_back(j);
+    }
+    if (j >= code->size() || !(*code)[j].isJump()) return false;
+    for (size_t k = nextLine(j); k < code->size() && (*code)[k].isLabel(); k = nextLine(k)) {
+        if ((*code)[k].label != branch.label) continue;
+        branch.op = invertBranch(branch.op);
+        retarget(branch, (*code)[j].label);
+        remove(j);
+        for (size_t b : between) remove(b);
+        return true;
+    }
+    return false;
+}
+
+// 向后的跳转多为回边，按"向后跳转、向前落入"的静态预测让条件分支承担回边：
+// 留在循环内的迭代少执行一条 j，只有离开循环时多走一条
+bool PeepholeOptimizer::backwardBranch(size_t i) {
+    MachineInstr& branch = (*code)[i];
+    if (!branch.isBranch()) return false;
+    size_t j = nextLine(i);
+    for (; j < code->size() && (*code)[j].isLabel(); j = nextLine(j)) {
+        if (labelRefs[(*code)[j].label] > 0) return false;
+    }
+    if (j >= code->size() || !(*code)[j].isJump()) return false;
+    MachineInstr& jump = (*code)[j];
+    auto back = labelIndex.find(jump.label);
+    auto forward = labelIndex.find(branch.label);
+    if (back == labelIndex.end() || forward == labelIndex.end()) return false;
+    // 两个目标同向时不改，否则改写后会再次匹配
+    if (back->second > i || forward->second < j) return false;
+    std::string_view target = branch.label;
+    branch.op = invertBranch(branch.op);
+    retarget(branch, jump.label);
+    retarget(jump, target);
+    return true;
+}
+
+bool PeepholeOptimizer::deadCode(size_t i) {
+    if (!(*code)[i].isJump() && (*code)[i].op != MOp::Ret) return false;
+    bool changed = false;
+    for (size_t k = nextLine(i); k < code->size(); k = nextLine(k)) {
+        const MachineInstr& l = (*code)[k];
+        if (l.isLabel() && labelRefs[l.label] > 0) break;
+        remove(k);
+        changed = true;
+    }
+    return changed;
+}
+
+// sw/lw rA, X(sp) 之后在同一直线代码中再次 lw rB, X(sp)：rA 未被改写时改为 mv 或删除
+bool PeepholeOptimizer::loadForwarding(size_t i) {
+    const MachineInstr& first = (*code)[i];
+    if ((first.op != MOp::Sw && first.op != MOp::Lw) || first.rs1 != Reg::sp) return false;
+    Reg reg = first.op == MOp::Sw ? first.rs2 : first.rd;
+    int slot = first.imm;
+    for (size_t k = nextLine(i); k < code->size(); k = nextLine(k)) {
+        MachineInstr& l = (*code)[k];
+        if (l.endsBlock()) return false;
+        bool sameSlot = l.rs1 == Reg::sp && l.imm == slot;
+        if (l.op == MOp::Lw && sameSlot) {
+            if (l.rd == reg) {
+                remove(k);
+            }
+            else {
+                l = MachineInstr::unary(MOp::Mv, l.rd, reg);
+            }
+            return true;
+        }
+        if (l.op == MOp::Sw && sameSlot) return false;
+        Reg def = l.def();
+        if (def == reg || def == Reg::sp) return false;
+    }
+    return false;
+}
+
+bool PeepholeOptimizer::redundantMove(size_t i) {
+    MachineInstr& l = (*code)[i];
+    if (l.op == MOp::Mv && l.rd == l.rs1) {
+        remove(i);
+        return true;
+    }
+    size_t k = nextLine(i);
+    if (k >= code->size() || (*code)[k].isLabel()) return false;
+    MachineInstr& next = (*code)[k];
+    // mv x, y; op ..., x ...  ->  op ..., y ...  (x 此后不再被读)
+    if (l.op == MOp::Mv && l.rs1 != Reg::zero && next.op != MOp::Sw && next.op != MOp::Lw
+        && next.op != MOp::Call && next.op != MOp::Ret
+        && next.reads(l.rd) && (next.def() == l.rd || deadAfter(k, l.rd))) {
+        if (next.rs1 == l.rd) next.rs1 = l.rs1;
+        if (next.rs2 == l.rd) next.rs2 = l.rs1;
+        remove(i);
+        return true;
+    }
+    if (next.op != MOp::Mv) return false;
+    // mv a, b; mv b, a
+    if (l.op == MOp::Mv && next.rd == l.rs1 && next.rs1 == l.rd) {
+        remove(k);
+        return true;
+    }
+    // op t, ...; mv rd, t  ->  op rd, ...
+    Reg def = l.def();
+    if (def != Reg::None && next.rs1 == def && deadAfter(k, def)) {
+        l.rd = next.rd;
+        remove(k);
+        return true;
+    }
+    return false;
+}
+
+bool PeepholeOptimizer::immediateFold(size_t i) {
+    const MachineInstr& li = (*code)[i];
+    if (li.op != MOp::Li || !isScratch(li.rd)) return false;
+    long long c = li.imm;
+    Reg reg = li.rd;
+    size_t k = nextLine(i);
+    if (k >= code->size() || (*code)[k].isLabel()) return false;
+    MachineInstr& use = (*code)[k];
+
+    MachineInstr folded = use;
+    if (use.op == MOp::Mv && use.rs1 == reg) {
+        folded = MachineInstr::li(use.rd, li.imm);
+    }
+    else if (use.rs2 == Reg::None || use.rs1 == use.rs2) {
+        return false;
+    }
+    else if (use.op == MOp::Add && (use.rs1 == reg || use.rs2 == reg) && fitsImm12(c)) {
+        folded = MachineInstr::ri(MOp::Addi, use.rd, use.rs1 == reg ? use.rs2 : use.rs1, static_cast<int>(c));
+    }
+    else if (use.op == MOp::Sub && use.rs2 == reg && fitsImm12(-c)) {
+        folded = MachineInstr::ri(MOp::Addi, use.rd, use.rs1, static_cast<int>(-c));
+    }
+    else if ((use.op == MOp::Slt || use.op == MOp::Sll) && use.rs2 == reg && fitsImm12(c)) {
+        folded = MachineInstr::ri(use.op == MOp::Slt ? MOp::Slti : MOp::Slli, use.rd, use.rs1,
+            static_cast<int>(use.op == MOp::Sll ? (c & 31) : c));
+    }
+    else {
+        return false;
+    }
+    if (use.rd != reg && !deadAfter(k, reg)) return false;
+    use = folded;
+    remove(i);
+    return true;
+}
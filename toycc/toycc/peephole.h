@@ -0,0 +1,52 @@
+#pragma once
+#include "machine.h"
+#include <array>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// 在生成的指令流上做窥孔优化，按规则表在窗口内匹配改写，反复应用直到不再变化。
+// 只在一个函数内进行；t0-t2 为代码生成的临时寄存器，不跨越标签与跳转存活。
+class PeepholeOptimizer {
+public:
+    enum Rule {
+        JumpToNext,        // 跳到紧随其后的标签
+        JumpThreading,     // 跳到另一条 j / ret
+        BranchOverJump,    // b<cond> L1; j L2; L1: 改为 b<!cond> L2
+        BackwardBranch,    // b<cond> L1; j L2，L2 在前 (回边) 而 L1 在后：改为 b<!cond> L2; j L1
+        DeadCode,          // 无条件跳转之后、下一个被引用的标签之前
+        LoadForwarding,    // sw/lw 之后再读同一栈槽
+        RedundantMove,     // mv x, x；来回拷贝；拷贝的源直接给唯一的使用者；结果直接写入拷贝目标
+        ImmediateFold,     // li t, c 后紧跟使用 t 的 R 型指令
+        NumRules
+    };
+
+    static const char* ruleName(Rule rule);
+
+    void run(std::vector<MachineInstr>& code);
+    const std::array<int, NumRules>& hits() const { return ruleHits; }
+
+private:
+    std::vector<MachineInstr>* code = nullptr;
+    std::vector<bool> removed;
+    std::unordered_map<std::string_view, int> labelRefs;       // 标签被跳转/分支引用的次数
+    std::unordered_map<std::string_view, size_t> labelIndex;   // 标签所在行，本轮内不变
+    std::array<int, NumRules> ruleHits{};
+
+    bool jumpToNext(size_t i);
+    bool jumpThreading(size_t i);
+    bool branchOverJump(size_t i);
+    bool backwardBranch(size_t i);
+    bool deadCode(size_t i);
+    bool loadForwarding(size_t i);
+    bool redundantMove(size_t i);
+    bool immediateFold(size_t i);
+
+    size_t nextLine(size_t i) const;       // 下一条未删除的行，没有时返回 size()
+    size_t nextInst(size_t i) const;       // 下一条未删除的指令 (跳过标签)
+    size_t targetOf(std::string_view label) const;   // 标签之后的第一条指令
+    bool deadAfter(size_t i, Reg reg) const;
+    void remove(size_t i);
+    void retarget(MachineInstr& jump, std::string_view label);
+    void countLabelRefs();
+};
@@ -0,0 +1,337 @@
+#include "pre.h"
+#include "dataflow.h"
+#include "ssaupdater.h"
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace {
+
+struct ExprKey {
+    Opcode op;
+    const Value* lhs;
+    const Value* rhs;
+
+    bool operator==(const ExprKey& o) const { return op == o.op && lhs == o.lhs && rhs == o.rhs; }
+};
+
+struct ExprKeyHash {
+    size_t operator()(const ExprKey& k) const {
+        size_t h = std::hash<const Value*>()(k.lhs);
+        h = h * 31 + std::hash<const Value*>()(k.rhs);
+        return h * 31 + static_cast<size_t>(k.op);
+    }
+};
+
+// 只移动 i32 算术；比较留在分支旁边，便于代码生成融合成条件跳转
+bool isCandidate(const Instruction* inst) {
+    return inst->op >= Opcode::Add && inst->op <= Opcode::Shl;
+}
+
+ExprKey keyOf(const Instruction* inst) {
+    const Value* a = inst->getOperand(0);
+    const Value* b = inst->getOperand(1);
+    if ((inst->op == Opcode::Add || inst->op == Opcode::Mul) && std::less<const Value*>()(b, a)) std::swap(a, b);
+    return { inst->op, a, b };
+}
+
+// 各块的局部性质，按求解器的块序号索引
+struct LocalSets {
+    size_t numExprs = 0;
+    std::vector<BitVector> use;    // 向上暴露的计算：操作数都不在本块定义
+    std::vector<BitVector> kill;   // 本块定义了某个操作数
+    std::vector<BitVector> comp;   // 本块算过且出口处仍有效
+    std::vector<BitVector> earliest;
+};
+
+// 可预期 (后向、交集)：in = use ∪ (out − kill)
+struct Anticipated {
+    using Set = BitVector;
+    static constexpr Direction direction = Direction::Backward;
+    static constexpr Meet meet = Meet::Intersection;
+    const LocalSets* local = nullptr;
+
+    Set boundary() const { return Set(local->numExprs); }
+    Set top() const { return Set(local->numExprs, true); }
+    void edge(const BasicBlock*, const BasicBlock*, Set&) const {}
+    void transfer(int b, const BasicBlock*, const Set& out, Set& in) const {
+        in = out;
+        in.subtract(local->kill[b]);
+        in.unionWith(local->use[b]);
+    }
+};
+
+// 可用 (前向、交集)：在入口可预期的表达式视为已放置，out = ((antIn ∪ in) − kill) ∪ comp
+struct Available {
+    using Set = BitVector;
+    static constexpr Direction direction = Direction::Forward;
+    static constexpr Meet meet = Meet::Intersection;
+    const LocalSets* local = nullptr;
+    const DataflowSolver<Anticipated>* anticipated = nullptr;
+
+    Set boundary() const { return Set(local->numExprs); }
+    Set top() const { return Set(local->numExprs, true); }
+    void edge(const BasicBlock*, const BasicBlock*, Set&) const {}
+    void transfer(int b, const BasicBlock* bb, const Set& in, Set& out) const {
+        out = in;
+        out.unionWith(anticipated->blockIn(bb));
+        out.subtract(local->kill[b]);
+        out.unionWith(local->comp[b]);
+    }
+};
+
+// 可推迟 (前向、交集)：out = (earliest ∪ in) − use
+struct Postponable {
+    using Set = BitVector;
+    static constexpr Direction direction = Direction::Forward;
+    static constexpr Meet meet = Meet::Intersection;
+    const LocalSets* local = nullptr;
+
+    Set boundary() const { return Set(local->numExprs); }
+    Set top() const { return Set(local->numExprs, true); }
+    void edge(const BasicBlock*, const BasicBlock*, Set&) const {}
+    void transfer(int b, const BasicBlock*, const Set& in, Set& out) const {
+        out = in;
+        out.unionWith(local->earliest[b]);
+        out.subtract(local->use[b]);
+    }
+};
+
+// 被使用 (后向、并集)：in = (use ∪ out) − latest
+struct Used {
+    using Set = BitVector;
+    static constexpr Direction direction = Direction::Backward;
+    static constexpr Meet meet = Meet::Union;
+    const LocalSets* local = nullptr;
+    const std::vector<BitVector>* latest = nullptr;
+
+    Set boundary() const { return Set(local->numExprs); }
+    Set top() const { return Set(local->numExprs); }
+    void edge(const BasicBlock*, const BasicBlock*, Set&) const {}
+    void transfer(int b, const BasicBlock*, const Set& out, Set& in) const {
+        in = out;
+        in.unionWith(local->use[b]);
+        in.subtract((*latest)[b]);
+    }
+};
+
+class PRE {
+public:
+    PRE(Function& func, PREStats& stats) : func(func), stats(stats) {}
+
+    bool run() {
+        func.recomputePreds();
+        std::unordered_set<const BasicBlock*> original;
+        for (auto& bb : func.blocks) original.insert(bb.get());
+        func.splitCriticalEdges();
+
+        bool changed = false;
+        if (collect()) changed = transform();
+        removeEmptySplits(original);
+        return changed;
+    }
+
+    bool keptSplits() const { return splitsKept; }
+
+private:
+    struct Expr {
+        Opcode op;
+        Value* lhs;
+        Value* rhs;
+    };
+
+    Function& func;
+    PREStats& stats;
+    std::vector<Expr> exprs;
+    std::unordered_map<ExprKey, size_t, ExprKeyHash> ids;
+    std::vector<BasicBlock*> blocks;   // 求解器序号 -> 块
+    std::unordered_map<const BasicBlock*, int> index;
+    // 每块中每个表达式的第一次与最后一次计算
+    std::vector<std::unordered_map<size_t, Instruction*>> first, last;
+    LocalSets local;
+    bool splitsKept = false;
+
+    bool collect() {
+        for (auto& bb : func.blocks) {
+            for (auto& inst : bb->insts) {
+                if (!isCandidate(inst.get())) continue;
+                auto [it, added] = ids.emplace(keyOf(inst.get()), exprs.size());
+                if (added) exprs.push_back({ inst->op, inst->getOperand(0), inst->getOperand(1) });
+            }
+        }
+        stats.expressions += static_cast<int>(exprs.size());
+        return !exprs.empty();
+    }
+
+    void computeLocal() {
+        size_t nb = blocks.size();
+        local.numExprs = exprs.size();
+        local.use.assign(nb, BitVector(exprs.size()));
+        local.kill.assign(nb, BitVector(exprs.size()));
+        local.comp.assign(nb, BitVector(exprs.size()));
+        first.assign(nb, {});
+        last.assign(nb, {});
+        for (size_t b = 0; b < nb; ++b) {
+            for (auto& inst : blocks[b]->insts) {
+                if (!isCandidate(inst.get())) continue;
+                size_t e = ids.at(keyOf(inst.get()));
+                if (!first[b].count(e)) first[b][e] = inst.get();
+                last[b][e] = inst.get();
+                local.comp[b].set(e);
+            }
+        }
+        for (size_t e = 0; e < exprs.size(); ++e) {
+            for (auto* v : { exprs[e].lhs, exprs[e].rhs }) {
+                if (!v->isInstruction()) continue;
+                auto it = index.find(static_cast<Instruction*>(v)->parent);
+                if (it != index.end()) local.kill[it->second].set(e);
+            }
+        }
+        for (size_t b = 0; b < nb; ++b) {
+            local.use[b] = local.comp[b];
+            local.use[b].subtract(local.kill[b]);
+        }
+    }
+
+    bool transform() {
+        Anticipated antProblem;
+        antProblem.local = &local;
+        DataflowSolver<Anticipated> anticipated(func, antProblem);
+        size_t nb = anticipated.numBlocks();
+        for (size_t b = 0; b < nb; ++b) {
+            auto* bb = const_cast<BasicBlock*>(anticipated.block(static_cast<int>(b)));
+            blocks.push_back(bb);
+            index[bb] = static_cast<int>(b);
+        }
+        computeLocal();
+        anticipated.solve();
+
+        Available avProblem;
+        avProblem.local = &local;
+        avProblem.anticipated = &anticipated;
+        DataflowSolver<Available> available(func, avProblem);
+        available.solve();
+
+        // 最早放置点：可预期但尚不可用
+        local.earliest.assign(nb, BitVector(exprs.size()));
+        for (size_t b = 0; b < nb; ++b) {
+            local.earliest[b] = anticipated.blockIn(blocks[b]);
+            local.earliest[b].subtract(available.blockIn(blocks[b]));
+        }
+
+        Postponable ppProblem;
+        ppProblem.local = &local;
+        DataflowSolver<Postponable> postponable(func, ppProblem);
+        postponable.solve();
+
+        // 最晚放置点：可以放在这里，且本块要用或不能再推迟到所有后继
+        std::vector<BitVector> frontier(nb, BitVector(exprs.size()));
+        for (size_t b = 0; b < nb; ++b) {
+            frontier[b] = local.earliest[b];
+            frontier[b].unionWith(postponable.blockIn(blocks[b]));
+        }
+        std::vector<BitVector> latest(nb, BitVector(exprs.size()));
+        for (size_t b = 0; b < nb; ++b) {
+            BitVector stop(exprs.size(), true);
+            for (auto* succ : blocks[b]->succs()) stop.intersectWith(frontier[index.at(succ)]);
+            BitVector all(exprs.size(), true);
+            all.subtract(stop);
+            all.unionWith(local.use[b]);
+            latest[b] = frontier[b];
+            latest[b].intersectWith(all);
+        }
+
+        Used usedProblem;
+        usedProblem.local = &local;
+        usedProblem.latest = &latest;
+        DataflowSolver<Used> used(func, usedProblem);
+        used.solve();
+
+        // 块入口插入 latest ∩ usedOut (本块已有向上暴露的计算时直接沿用它)；
+        // 不是最晚点的向上暴露计算改用到达的值
+        std::vector<std::unordered_map<size_t, Instruction*>> inserted(nb);
+        std::vector<BitVector> replace(nb, BitVector(exprs.size()));
+        bool changed = false;
+        for (size_t b = 0; b < nb; ++b) {
+            BitVector insert = latest[b];
+            insert.intersectWith(used.blockOut(blocks[b]));
+            insert.subtract(local.use[b]);
+            insert.forEach([&](size_t e) {
+                auto inst = makeInst(exprs[e].op, IRType::I32, { exprs[e].lhs, exprs[e].rhs });
+                inserted[b][e] = blocks[b]->insertAfterPhis(std::move(inst));
+                ++stats.inserted;
+                changed = true;
+            });
+            replace[b] = local.use[b];
+            replace[b].subtract(latest[b]);
+        }
+
+        // 每个表达式按需重建 SSA：块出口的值是块内最后一次保留的计算或插入的计算
+        for (size_t e = 0; e < exprs.size(); ++e) {
+            std::vector<Instruction*> victims;
+            for (size_t b = 0; b < nb; ++b) {
+                if (replace[b].test(e)) victims.push_back(first[b].at(e));
+            }
+            if (victims.empty()) continue;
+            SSAUpdater updater;
+            for (size_t b = 0; b < nb; ++b) {
+                auto it = last[b].find(e);
+                auto ins = inserted[b].find(e);
+                if (it != last[b].end() && !(replace[b].test(e) && it->second == first[b].at(e))) {
+                    updater.addDefinition(blocks[b], it->second);
+                }
+                else if (ins != inserted[b].end()) {
+                    updater.addDefinition(blocks[b], ins->second);
+                }
+            }
+            std::vector<std::pair<Instruction*, Value*>> values;
+            for (auto* inst : victims) values.emplace_back(inst, updater.valueAtEntry(inst->parent));
+            for (auto& [inst, v] : values) {
+                inst->replaceAllUsesWith(v);
+                inst->parent->erase(inst);
+                ++stats.replaced;
+            }
+            updater.removeTrivialPhis();
+            changed = true;
+        }
+        return changed;
+    }
+
+    // 删去仍只有一条跳转的拆分块，恢复原来的边
+    void removeEmptySplits(const std::unordered_set<const BasicBlock*>& original) {
+        std::vector<BasicBlock*> dead;
+        for (auto& bb : func.blocks) {
+            BasicBlock* mid = bb.get();
+            if (original.count(mid) || mid->insts.size() != 1) continue;
+            BasicBlock* from = mid->preds[0];
+            BasicBlock* to = mid->succs()[0];
+            auto fromSuccs = from->succs();
+            if (std::find(fromSuccs.begin(), fromSuccs.end(), to) != fromSuccs.end()) continue;
+            from->terminator()->replaceBlock(mid, to);
+            for (auto& inst : to->insts) {
+                if (!inst->isPhi()) break;
+                inst->replaceBlock(mid, from);
+            }
+            std::replace(to->preds.begin(), to->preds.end(), mid, from);
+            dead.push_back(mid);
+        }
+        for (auto* mid : dead) {
+            func.blocks.erase(std::find_if(func.blocks.begin(), func.blocks.end(),
+                [&](const std::unique_ptr<BasicBlock>& bb) { return bb.get() == mid; }));
+        }
+        splitsKept = false;
+        for (auto& bb : func.blocks) {
+            if (!original.count(bb.get())) splitsKept = true;
+        }
+    }
+};
+
+} // namespace
+
+Preserved runPRE(Function& func, PREStats& stats) {
+    PRE pre(func, stats);
+    bool changed = pre.run();
+    if (pre.keptSplits()) return Preserved::None;
+    return changed ? Preserved::CFG : Preserved::All;
+}
@@ -0,0 +1,16 @@
+#pragma once
+#include "ir.h"
+#include "analysis.h"
+
+struct PREStats {
+    int expressions = 0;   // 参与分析的表达式 (按操作码与操作数区分)
+    int inserted = 0;      // 新放置的计算
+    int replaced = 0;      // 改用已有结果、不再重复计算的原计算
+};
+
+// 部分冗余消除 (惰性代码移动, Knoop-Rüthing-Steffen)：先拆分关键边，由可预期与可用表达式
+// 求最早放置点，再尽量推迟到最晚的安全点，只在结果确实被使用的地方插入计算。
+// 任何路径上的计算次数都不会增加。SSA 中表达式以 (操作码, 操作数值) 区分，
+// 定义某操作数的块 (包括其 phi) 视为杀死该表达式，因此不跨 phi 翻译。
+// 插入与保留的计算之间按需建立 phi；最后删去仍为空的拆分块
+Preserved runPRE(Function& func, PREStats& stats);
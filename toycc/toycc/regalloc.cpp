@@ -0,0 +1,556 @@
+#include "regalloc.h"
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+
+const std::vector<Reg>& callerSavedRegs() {
+    // a 寄存器倒序排列，使不相关的值尽量避开 a0/a1 等常用的参数寄存器
+    static const std::vector<Reg> regs = {
+        Reg::t3, Reg::t4, Reg::t5, Reg::t6, Reg::a7, Reg::a6, Reg::a5, Reg::a4, Reg::a3, Reg::a2, Reg::a1, Reg::a0
+    };
+    return regs;
+}
+
+const std::vector<Reg>& calleeSavedRegs() {
+    static const std::vector<Reg> regs = {
+        Reg::s0, Reg::s1, Reg::s2, Reg::s3, Reg::s4, Reg::s5, Reg::s6, Reg::s7, Reg::s8, Reg::s9, Reg::s10, Reg::s11
+    };
+    return regs;
+}
+
+bool isFusedCompare(const Value* v) {
+    if (!v->isInstruction() || v->users.size() != 1) return false;
+    auto* inst = static_cast<const Instruction*>(v);
+    auto& insts = inst->parent->insts;
+    return inst->isCompare() && v->users[0]->op == Opcode::CondBr && insts.size() >= 2
+        && insts.back().get() == v->users[0] && std::prev(insts.end(), 2)->get() == inst;
+}
+
+LinearScanAllocator::LinearScanAllocator(Function& func, AnalysisManager& am) : func(func), am(am) {
+    allRegs = callerSavedRegs();
+    allRegs.insert(allRegs.end(), calleeSavedRegs().begin(), calleeSavedRegs().end());
+}
+
+bool LinearScanAllocator::isCalleeSaved(int reg) const {
+    return reg >= static_cast<int>(callerSavedRegs().size());
+}
+
+// 参数在位置 0 定义；每个块的 phi 位于块起始位置，其余指令从起始位置 + 2 开始每条占 2。
+// 活跃于块入口/出口的值分别延伸到块的起止位置，phi 的使用由活跃分析计入前驱出口。
+void LinearScanAllocator::buildIntervals() {
+    auto& live = am.liveness();
+
+    std::vector<Value*> values(live.universe(), nullptr);
+    std::unordered_map<const Value*, size_t> index;
+    auto touch = [&](Value* v, int pos) {
+        auto it = index.find(v);
+        if (it == index.end()) {
+            index[v] = intervals.size();
+            LiveInterval iv;
+            iv.value = v;
+            iv.start = iv.end = pos;
+            intervals.push_back(iv);
+            return;
+        }
+        auto& iv = intervals[it->second];
+        iv.start = std::min(iv.start, pos);
+        iv.end = std::max(iv.end, pos);
+    };
+
+    for (auto& arg : func.args) {
+        values[arg->id] = arg.get();
+        touch(arg.get(), 0);
+    }
+    for (auto& bb : func.blocks) {
+        for (auto& inst : bb->insts) {
+            if (inst->type != IRType::Void) values[inst->id] = inst.get();
+        }
+    }
+
+    int pos = 2;
+    for (auto& bb : func.blocks) {
+        int from = pos;
+        int cur = from + 2;
+        for (auto& inst : bb->insts) {
+            if (inst->isPhi()) {
+                touch(inst.get(), from);
+                continue;
+            }
+            // 合并入分支的比较在分支处读操作数，两者相邻，其间没有其他定义
+            for (auto* op : inst->operands) {
+                if (!op->isConstant() && !isFusedCompare(op)) touch(op, cur);
+            }
+            if (inst->type != IRType::Void && !isFusedCompare(inst.get())) touch(inst.get(), cur);
+            if (inst->op == Opcode::Call) calls.emplace_back(cur, inst.get());
+            cur += 2;
+        }
+        int to = cur;
+        live.liveIn(bb.get()).forEach([&](size_t id) { touch(values[id], from); });
+        live.liveOut(bb.get()).forEach([&](size_t id) { touch(values[id], to); });
+        pos = to;
+    }
+
+    for (auto& iv : intervals) {
+        auto first = std::upper_bound(calls.begin(), calls.end(), std::make_pair(iv.start, (Instruction*)nullptr),
+            [](const std::pair<int, Instruction*>& a, const std::pair<int, Instruction*>& b) { return a.first < b.first; });
+        for (auto it = first; it != calls.end() && it->first < iv.end; ++it) ++iv.callsCrossed;
+        iv.crossesCall = iv.callsCrossed > 0;
+    }
+    for (auto& iv : intervals) {
+        intervalOf[iv.value] = &iv;
+    }
+    for (auto& bb : func.blocks) {
+        for (auto& inst : bb->insts) {
+            if (intervalOf.count(inst.get())) ++intervalOf[inst.get()]->uses;
+            for (auto* op : inst->operands) {
+                if (intervalOf.count(op)) ++intervalOf[op]->uses;
+            }
+        }
+    }
+}
+
+// 枚举可消去 move 的分配偏好：related(a, b) 为 phi/zext 的两端，fixed(v, reg) 为 ABI 规定 v 所在的 a 寄存器
+template <typename Related, typename Fixed>
+static void forEachHint(Function& func, Related related, Fixed fixed) {
+    for (size_t i = 0; i < func.args.size() && i < 8; ++i) {
+        fixed(func.args[i].get(), argReg(i));
+    }
+    for (auto& bb : func.blocks) {
+        for (auto& inst : bb->insts) {
+            switch (inst->op) {
+            case Opcode::Phi:
+            case Opcode::Copy:
+            case Opcode::ZExt:
+                // zext 在寄存器中不改变值，与拷贝一样可合并
+                for (size_t i = 0; i < inst->operands.size(); ++i) {
+                    Value* op = inst->operands[i];
+                    if (!op->isConstant()) related(inst.get(), op, inst->isPhi() ? inst->blocks[i] : bb.get());
+                }
+                break;
+            case Opcode::Call:
+                for (size_t i = 0; i < inst->operands.size() && i < 8; ++i) {
+                    Value* op = inst->operands[i];
+                    if (!op->isConstant()) fixed(op, argReg(i));
+                }
+                if (inst->type != IRType::Void) fixed(inst.get(), Reg::a0);
+                break;
+            case Opcode::Ret:
+                if (!inst->operands.empty() && !inst->operands[0]->isConstant()) {
+                    fixed(inst->operands[0], Reg::a0);
+                }
+                break;
+            default:
+                break;
+            }
+        }
+    }
+}
+
+void LinearScanAllocator::addHints() {
+    forEachHint(func,
+        [&](Value* a, Value* b, BasicBlock*) {
+            intervalOf[a]->related.push_back(b);
+            intervalOf[b]->related.push_back(a);
+        },
+        [&](Value* v, Reg reg) { intervalOf[v]->fixedHints.push_back(reg); });
+}
+
+// 依次尝试：相关值已分到的寄存器、固定提示寄存器、按偏好顺序的第一个空闲寄存器。
+// 跨越 call 的区间只选被调用者保存寄存器，除非 anyClass 为 true。
+int LinearScanAllocator::chooseRegister(const LiveInterval& cur, const std::vector<bool>& regFree, bool anyClass) const {
+    auto usable = [&](int r) {
+        return r >= 0 && regFree[r] && (anyClass || !cur.crossesCall || isCalleeSaved(r));
+    };
+    // 相关值尚未分配时再看它的相关值 (同一 phi 的其他来源)，使各来源落到同一寄存器
+    for (int depth = 0; depth < 2; ++depth) {
+        for (auto* v : cur.related) {
+            const LiveInterval* iv = intervalOf.at(v);
+            if (depth == 0 && usable(iv->reg)) return iv->reg;
+            if (depth == 1 && iv->reg < 0) {
+                for (auto* w : iv->related) {
+                    if (usable(intervalOf.at(w)->reg)) return intervalOf.at(w)->reg;
+                }
+            }
+        }
+    }
+    for (Reg name : cur.fixedHints) {
+        int r = static_cast<int>(std::find(allRegs.begin(), allRegs.end(), name) - allRegs.begin());
+        if (usable(r)) return r;
+    }
+    for (int r = 0; r < static_cast<int>(allRegs.size()); ++r) {
+        if (usable(r)) return r;
+    }
+    return -1;
+}
+
+// 栈槽着色：溢出值与调用点保存值按起点顺序分配栈槽，生存期不相交的区间复用同一槽，
+// 帧中的槽数即同时活跃的最大数目。判定与寄存器的到期规则相同
+void LinearScanAllocator::assignStackSlots(const std::vector<LiveInterval*>& order, Allocation& result) const {
+    std::vector<const LiveInterval*> lastInSlot;    // 每个槽中最后 (结束最晚) 的区间
+    for (auto* cur : order) {
+        if (cur->reg >= 0 && !cur->saveAroundCalls) continue;
+        int slot = 0;
+        for (; slot < static_cast<int>(lastInSlot.size()); ++slot) {
+            const LiveInterval* iv = lastInSlot[slot];
+            if (iv->end < cur->start || (iv->end == cur->start && iv->start < cur->start)) break;
+        }
+        if (slot == static_cast<int>(lastInSlot.size())) lastInSlot.push_back(cur);
+        else lastInSlot[slot] = cur;
+        if (cur->reg < 0) result.spillSlots[cur->value] = slot;
+        else result.saveSlots[cur->value] = slot;
+    }
+    result.numSpillSlots = static_cast<int>(lastInSlot.size());
+}
+
+Allocation LinearScanAllocator::run() {
+    buildIntervals();
+    addHints();
+
+    std::vector<LiveInterval*> order;
+    for (auto& iv : intervals) order.push_back(&iv);
+    std::stable_sort(order.begin(), order.end(), [](const LiveInterval* a, const LiveInterval* b) {
+        return a->start < b->start;
+    });
+
+    Allocation result;
+    std::vector<bool> regFree(allRegs.size(), true);
+    std::vector<bool> regUsed(allRegs.size(), false);
+    std::vector<LiveInterval*> active;
+
+    auto spill = [&](LiveInterval* iv) {
+        iv->reg = -1;
+        iv->saveAroundCalls = false;
+    };
+
+    for (auto* cur : order) {
+        // 结束于当前起点的区间可让出寄存器 (指令先读操作数再写结果)，
+        // 但同一位置定义的值 (如同块的多个 phi) 必须互不相同
+        for (auto it = active.begin(); it != active.end();) {
+            LiveInterval* iv = *it;
+            if (iv->end < cur->start || (iv->end == cur->start && iv->start < cur->start)) {
+                regFree[iv->reg] = true;
+                it = active.erase(it);
+            }
+            else {
+                ++it;
+            }
+        }
+
+        int reg = chooseRegister(*cur, regFree);
+        if (reg < 0 && cur->crossesCall && 2 * cur->callsCrossed < cur->uses) {
+            // 每跨越一次调用需一对保存/恢复，整体溢出则每次定义/使用各一次访存
+            reg = chooseRegister(*cur, regFree, true);
+            cur->saveAroundCalls = reg >= 0;
+        }
+        if (reg < 0) {
+            // 无空闲寄存器：在可用寄存器中找结束最远的活动区间，比当前区间更远则抢占
+            LiveInterval* victim = nullptr;
+            for (auto* iv : active) {
+                if (cur->crossesCall && !isCalleeSaved(iv->reg)) continue;
+                if (!victim || iv->end > victim->end) victim = iv;
+            }
+            if (!victim || victim->end <= cur->end) {
+                spill(cur);
+                continue;
+            }
+            reg = victim->reg;
+            active.erase(std::find(active.begin(), active.end(), victim));
+            spill(victim);
+        }
+
+        cur->reg = reg;
+        regFree[reg] = false;
+        regUsed[reg] = true;
+        active.push_back(cur);
+    }
+
+    assignStackSlots(order, result);
+    for (auto& iv : intervals) {
+        if (iv.reg >= 0) result.regs[iv.value] = allRegs[iv.reg];
+        if (!iv.saveAroundCalls) continue;
+        for (auto& [pos, call] : calls) {
+            if (iv.start < pos && pos < iv.end) result.savedAroundCall[call].push_back(iv.value);
+        }
+    }
+    for (int r = 0; r < static_cast<int>(allRegs.size()); ++r) {
+        if (regUsed[r] && isCalleeSaved(r)) result.calleeSaved.push_back(allRegs[r]);
+    }
+    return result;
+}
+
+// ---------------- 图着色分配 ----------------
+
+static double depthWeight(int depth) {
+    double w = 1;
+    for (int i = 0; i < depth && i < 8; ++i) w *= 10;
+    return w;
+}
+
+GraphColoringAllocator::GraphColoringAllocator(Function& func, AnalysisManager& am) : func(func), am(am) {
+    allRegs = callerSavedRegs();
+    allRegs.insert(allRegs.end(), calleeSavedRegs().begin(), calleeSavedRegs().end());
+}
+
+void GraphColoringAllocator::addEdge(int a, int b) {
+    if (a == b) return;
+    nodes[a].adj.insert(b);
+    nodes[b].adj.insert(a);
+}
+
+int GraphColoringAllocator::find(int n) {
+    while (nodes[n].alias >= 0) n = nodes[n].alias;
+    return n;
+}
+
+int GraphColoringAllocator::colorsFor(const Node& n) const {
+    return static_cast<int>(n.crossesCall ? calleeSavedRegs().size() : allRegs.size());
+}
+
+// 在每个块内自后向前扫描：定义点与此时所有活跃值冲突 (拷贝类指令不与其源冲突)，
+// call 之后仍活跃的值标记为跨越调用；同一块的 phi 之间、各参数之间两两冲突
+void GraphColoringAllocator::buildGraph() {
+    auto& live = am.liveness();
+    auto& loops = am.loopInfo();
+    nodes.assign(live.universe(), Node());
+    for (auto& arg : func.args) {
+        nodes[arg->id].value = arg.get();
+    }
+    for (auto& bb : func.blocks) {
+        for (auto& inst : bb->insts) {
+            if (inst->type != IRType::Void && !isFusedCompare(inst.get())) nodes[inst->id].value = inst.get();
+        }
+    }
+
+    for (auto& bb : func.blocks) {
+        double weight = depthWeight(loops.loopDepth(bb.get()));
+        Liveness::Set current = live.liveOut(bb.get());
+        std::vector<int> phis;
+        for (auto it = bb->insts.rbegin(); it != bb->insts.rend(); ++it) {
+            Instruction* inst = it->get();
+            if (inst->isPhi()) {
+                phis.push_back(inst->id);
+                nodes[inst->id].spillCost += weight;
+                continue;
+            }
+            if (inst->type != IRType::Void && !isFusedCompare(inst)) {
+                int def = inst->id;
+                int src = (inst->op == Opcode::ZExt || inst->op == Opcode::Copy) && !inst->operands[0]->isConstant()
+                    ? inst->operands[0]->id : -1;
+                current.reset(def);
+                current.forEach([&](size_t w) {
+                    if (static_cast<int>(w) != src) addEdge(def, static_cast<int>(w));
+                });
+                nodes[def].spillCost += weight;
+            }
+            if (inst->op == Opcode::Call) {
+                current.forEach([&](size_t w) { nodes[w].crossesCall = true; });
+            }
+            for (auto* op : inst->operands) {
+                if (op->isConstant() || isFusedCompare(op)) continue;
+                current.set(op->id);
+                nodes[op->id].spillCost += weight;
+            }
+        }
+        for (int p : phis) {
+            current.reset(p);
+        }
+        for (size_t i = 0; i < phis.size(); ++i) {
+            current.forEach([&](size_t w) { addEdge(phis[i], static_cast<int>(w)); });
+            for (size_t j = i + 1; j < phis.size(); ++j) addEdge(phis[i], phis[j]);
+        }
+        // phi 的使用计在对应前驱
+        for (auto& inst : bb->insts) {
+            if (!inst->isPhi()) break;
+            for (size_t i = 0; i < inst->operands.size(); ++i) {
+                Value* op = inst->operands[i];
+                if (!op->isConstant()) nodes[op->id].spillCost += depthWeight(loops.loopDepth(inst->blocks[i]));
+            }
+        }
+    }
+    for (size_t i = 0; i < func.args.size(); ++i) {
+        for (size_t j = i + 1; j < func.args.size(); ++j) addEdge(func.args[i]->id, func.args[j]->id);
+    }
+
+    forEachHint(func,
+        [&](Value* a, Value* b, BasicBlock* bb) {
+            moves.push_back({ a->id, b->id, depthWeight(loops.loopDepth(bb)) });
+            nodes[a->id].moveRelated.push_back(b->id);
+            nodes[b->id].moveRelated.push_back(a->id);
+        },
+        [&](Value* v, Reg reg) { nodes[v->id].fixedHints.push_back(reg); });
+}
+
+// Briggs 保守合并：合并后度数不小于可用颜色数的邻居少于可用颜色数时才合并，保证不引入溢出
+void GraphColoringAllocator::coalesce() {
+    std::stable_sort(moves.begin(), moves.end(), [](const MovePair& x, const MovePair& y) {
+        return x.weight > y.weight;
+    });
+    for (auto& m : moves) {
+        int a = find(m.a), b = find(m.b);
+        if (a == b || nodes[a].adj.count(b)) continue;
+        // 只有一端跨越调用时不合并，否则另一端也被迫使用 s 寄存器 (如收缩包装拆分出的参数副本)
+        if (nodes[a].crossesCall != nodes[b].crossesCall) continue;
+
+        Node& na = nodes[a];
+        Node& nb = nodes[b];
+        int k = static_cast<int>(na.crossesCall || nb.crossesCall ? calleeSavedRegs().size() : allRegs.size());
+        int significant = 0;
+        auto countSignificant = [&](int n, bool shared) {
+            int degree = static_cast<int>(nodes[n].adj.size()) - (shared ? 1 : 0);
+            if (degree >= colorsFor(nodes[n])) ++significant;
+        };
+        for (int n : na.adj) countSignificant(n, nb.adj.count(n) != 0);
+        for (int n : nb.adj) {
+            if (!na.adj.count(n)) countSignificant(n, false);
+        }
+        if (significant >= k) continue;
+
+        for (int n : nb.adj) {
+            nodes[n].adj.erase(b);
+            addEdge(a, n);
+        }
+        nb.adj.clear();
+        nb.alias = a;
+        na.crossesCall = na.crossesCall || nb.crossesCall;
+        na.spillCost += nb.spillCost;
+        na.fixedHints.insert(na.fixedHints.end(), nb.fixedHints.begin(), nb.fixedHints.end());
+        na.moveRelated.insert(na.moveRelated.end(), nb.moveRelated.begin(), nb.moveRelated.end());
+    }
+}
+
+// 依次偏向：已着色的 move 相关结点、ABI 提示寄存器、偏好顺序中第一个可用颜色
+int GraphColoringAllocator::pickColor(int n) {
+    Node& node = nodes[n];
+    std::vector<bool> taken(allRegs.size(), false);
+    for (int m : node.adj) {
+        if (nodes[m].color >= 0) taken[nodes[m].color] = true;
+    }
+    int first = node.crossesCall ? static_cast<int>(callerSavedRegs().size()) : 0;
+    auto usable = [&](int c) { return c >= first && !taken[c]; };
+
+    for (int m : node.moveRelated) {
+        int c = nodes[find(m)].color;
+        if (c >= 0 && usable(c)) return c;
+    }
+    for (Reg name : node.fixedHints) {
+        int c = static_cast<int>(std::find(allRegs.begin(), allRegs.end(), name) - allRegs.begin());
+        if (c < static_cast<int>(allRegs.size()) && usable(c)) return c;
+    }
+    for (int c = first; c < static_cast<int>(allRegs.size()); ++c) {
+        if (usable(c)) return c;
+    }
+    return -1;
+}
+
+// 栈槽着色：在冲突图上给溢出结点再着一次色 (颜色数不限)，互不冲突的溢出值共用栈槽；
+// 优先沿用 move 相关结点的槽，使 phi 拷贝两端落在同一槽中而被消去
+std::vector<int> GraphColoringAllocator::assignStackSlots() {
+    std::vector<int> slotOf(nodes.size(), -1);
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        Node& node = nodes[i];
+        if (!node.value || node.alias >= 0 || node.color >= 0) continue;
+        std::vector<bool> taken;
+        for (int m : node.adj) {
+            if (slotOf[m] < 0) continue;
+            if (slotOf[m] >= static_cast<int>(taken.size())) taken.resize(slotOf[m] + 1, false);
+            taken[slotOf[m]] = true;
+        }
+        auto usable = [&](int s) { return s >= 0 && (s >= static_cast<int>(taken.size()) || !taken[s]); };
+        int slot = -1;
+        for (int m : node.moveRelated) {
+            if (usable(slotOf[find(m)])) {
+                slot = slotOf[find(m)];
+                break;
+            }
+        }
+        if (slot < 0) {
+            slot = 0;
+            while (!usable(slot)) ++slot;
+        }
+        slotOf[i] = slot;
+    }
+    return slotOf;
+}
+
+Allocation GraphColoringAllocator::run() {
+    buildGraph();
+    coalesce();
+
+    // 化简：反复移除度数小于可用颜色数的结点；都不满足时乐观地移除代价/度数最小的结点
+    std::vector<int> degree(nodes.size(), 0);
+    std::vector<bool> removed(nodes.size(), true);
+    std::vector<int> low, remaining;
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        if (!nodes[i].value || nodes[i].alias >= 0) continue;
+        removed[i] = false;
+        degree[i] = static_cast<int>(nodes[i].adj.size());
+        if (degree[i] < colorsFor(nodes[i])) low.push_back(static_cast<int>(i));
+        else remaining.push_back(static_cast<int>(i));
+    }
+
+    std::vector<int> stack;
+    auto removeNode = [&](int n) {
+        removed[n] = true;
+        stack.push_back(n);
+        for (int m : nodes[n].adj) {
+            if (removed[m]) continue;
+            if (--degree[m] == colorsFor(nodes[m]) - 1) low.push_back(m);
+        }
+    };
+
+    size_t left = low.size() + remaining.size();
+    while (stack.size() < left) {
+        if (!low.empty()) {
+            int n = low.back();
+            low.pop_back();
+            if (!removed[n]) removeNode(n);
+            continue;
+        }
+        int best = -1;
+        double bestCost = 0;
+        size_t out = 0;
+        for (int n : remaining) {
+            if (removed[n]) continue;
+            remaining[out++] = n;
+            double cost = nodes[n].spillCost / (degree[n] + 1);
+            if (best < 0 || cost < bestCost) {
+                best = n;
+                bestCost = cost;
+            }
+        }
+        remaining.resize(out);
+        removeNode(best);
+    }
+
+    // 选色
+    Allocation result;
+    std::vector<bool> used(allRegs.size(), false);
+    for (auto it = stack.rbegin(); it != stack.rend(); ++it) {
+        int c = pickColor(*it);
+        nodes[*it].color = c;
+        if (c >= 0) used[c] = true;
+    }
+
+    std::vector<int> slotOf = assignStackSlots();
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        if (!nodes[i].value) continue;
+        int root = find(static_cast<int>(i));
+        if (nodes[root].color >= 0) {
+            result.regs[nodes[i].value] = allRegs[nodes[root].color];
+            continue;
+        }
+        result.spillSlots[nodes[i].value] = slotOf[root];   // 合并在一起的值共用一个槽
+        result.numSpillSlots = std::max(result.numSpillSlots, slotOf[root] + 1);
+    }
+    for (size_t c = callerSavedRegs().size(); c < allRegs.size(); ++c) {
+        if (used[c]) result.calleeSaved.push_back(allRegs[c]);
+    }
+    return result;
+}
+
+Allocation allocateRegisters(Function& func, AnalysisManager& am, RegAllocKind kind) {
+    if (kind == RegAllocKind::GraphColoring) {
+        return GraphColoringAllocator(func, am).run();
+    }
+    return LinearScanAllocator(func, am).run();
+}
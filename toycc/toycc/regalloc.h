@@ -0,0 +1,113 @@
+#pragma once
+#include "ir.h"
+#include "analysis.h"
+#include "machine.h"
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// 可分配的寄存器。t0-t2 留给代码生成做临时寄存器
+// (装载溢出值与常量、大偏移地址计算、并行拷贝破环)，不参与分配。
+const std::vector<Reg>& callerSavedRegs();   // t3-t6, a0-a7
+const std::vector<Reg>& calleeSavedRegs();   // s0-s11
+
+// 只被紧随其后的 condbr 使用的比较，由代码生成与分支合并为一条 b<cond>，不占寄存器
+bool isFusedCompare(const Value* v);
+
+enum class RegAllocKind {
+    LinearScan,      // 默认：编译快
+    GraphColoring    // -O3：以编译时间换更少的溢出与拷贝
+};
+
+// 寄存器分配结果：每个非常量 SSA 值位于一个寄存器或一个溢出槽
+struct Allocation {
+    std::unordered_map<const Value*, Reg> regs;
+    std::unordered_map<const Value*, int> spillSlots;   // 值 -> 溢出槽编号，生存期不相交的值共用槽
+    int numSpillSlots = 0;
+    std::vector<Reg> calleeSaved;                       // 用到的 s 寄存器，需在序言中保存
+
+    // 跨越调用却放在调用者保存寄存器中的值：只在其跨越的 call 前后保存/恢复，
+    // 保存槽与溢出槽统一编号
+    std::unordered_map<const Instruction*, std::vector<const Value*>> savedAroundCall;
+    std::unordered_map<const Value*, int> saveSlots;
+};
+
+// 活跃区间：指令按块布局顺序线性编号后，值活跃范围的包络 [start, end]
+struct LiveInterval {
+    Value* value = nullptr;
+    int start = 0;
+    int end = 0;
+    bool crossesCall = false;               // 跨越 call 的值优先放在 s 寄存器中
+    bool saveAroundCalls = false;           // 放在调用者保存寄存器中，由调用点保存/恢复
+    int uses = 0;                           // 定义与使用次数，用于比较溢出与调用点保存的代价
+    int callsCrossed = 0;
+    std::vector<Reg> fixedHints;            // 希望位于的物理寄存器 (参数、返回值所在的 a 寄存器)
+    std::vector<Value*> related;            // phi/拷贝的另一端，分到同一寄存器即可消去 move
+    int reg = -1;                           // 在候选寄存器表中的下标
+};
+
+// 线性扫描分配 (Poletto & Sarkar)，寄存器不足时溢出结束位置最远的区间。
+// 跨越调用的区间分不到 s 寄存器时，若调用点保存/恢复比整体溢出便宜则放入调用者保存寄存器。
+// 调用前需已拆分通往 phi 块的关键边，使 phi 拷贝可以放在前驱末尾。
+class LinearScanAllocator {
+public:
+    LinearScanAllocator(Function& func, AnalysisManager& am);
+    Allocation run();
+
+private:
+    Function& func;
+    AnalysisManager& am;
+    std::vector<LiveInterval> intervals;
+    std::unordered_map<const Value*, LiveInterval*> intervalOf;
+    std::vector<Reg> allRegs;               // 调用者保存寄存器在前，被调用者保存寄存器在后
+    std::vector<std::pair<int, Instruction*>> calls;   // 按位置排序的调用点
+
+    void buildIntervals();
+    void addHints();
+    int chooseRegister(const LiveInterval& cur, const std::vector<bool>& regFree, bool anyClass = false) const;
+    void assignStackSlots(const std::vector<LiveInterval*>& order, Allocation& result) const;
+    bool isCalleeSaved(int reg) const;
+};
+
+// Chaitin-Briggs 图着色分配。按指令粒度构造冲突图，保守合并 (Briggs 准则) phi/zext 两端，
+// 乐观着色；溢出代价为各定义、使用按 10^循环深度 加权之和除以度数。
+// 选色时偏向已着色的 move 相关值与 ABI 参数寄存器，以消去调用前后的参数拷贝。
+class GraphColoringAllocator {
+public:
+    GraphColoringAllocator(Function& func, AnalysisManager& am);
+    Allocation run();
+
+private:
+    struct Node {
+        Value* value = nullptr;
+        std::unordered_set<int> adj;
+        bool crossesCall = false;
+        double spillCost = 0;
+        std::vector<Reg> fixedHints;
+        std::vector<int> moveRelated;   // 未能合并时用于偏向着色
+        int alias = -1;                 // 被合并到的结点
+        int color = -1;
+    };
+    struct MovePair {
+        int a;
+        int b;
+        double weight;
+    };
+
+    Function& func;
+    AnalysisManager& am;
+    std::vector<Node> nodes;
+    std::vector<MovePair> moves;
+    std::vector<Reg> allRegs;
+
+    void buildGraph();
+    void addEdge(int a, int b);
+    void coalesce();
+    int find(int n);
+    int colorsFor(const Node& n) const;
+    int pickColor(int n);
+    std::vector<int> assignStackSlots();
+};
+
+Allocation allocateRegisters(Function& func, AnalysisManager& am, RegAllocKind kind);
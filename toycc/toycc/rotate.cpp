@@ -0,0 +1,182 @@
+#include "rotate.h"
+#include "ssaupdater.h"
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace {
+
+// header 中可复制的计算条数上限，更长的测试复制多份得不偿失
+constexpr int kMaxHeaderSize = 8;
+// 回边源块 (如 continue) 各得一份测试，数目过多时不旋转
+constexpr size_t kMaxLatches = 4;
+
+using ValueMap = std::unordered_map<const Value*, Value*>;
+
+Value* lookup(const ValueMap& map, Value* v) {
+    auto it = map.find(v);
+    return it == map.end() ? v : it->second;
+}
+
+bool canRotate(Loop* loop, BasicBlock*& body, BasicBlock*& exit) {
+    BasicBlock* header = loop->header;
+    BasicBlock* pre = loop->preheader();
+    if (!pre || pre->terminator()->op != Opcode::Br || loop->latches.size() > kMaxLatches) return false;
+    for (auto* latch : loop->latches) {
+        // 单块循环本就在底部测试
+        if (latch == header || latch->terminator()->op != Opcode::Br) return false;
+    }
+    Instruction* term = header->terminator();
+    if (!term || term->op != Opcode::CondBr) return false;
+
+    BasicBlock* t = term->blocks[0];
+    BasicBlock* f = term->blocks[1];
+    if (loop->contains(t) == loop->contains(f)) return false;
+    body = loop->contains(t) ? t : f;
+    exit = loop->contains(t) ? f : t;
+    if (body == header || body->preds.size() != 1) return false;
+
+    int size = 0;
+    for (auto& inst : header->insts) {
+        if (inst->isPhi()) {
+            // 回边带回的是 header 中算出的值时，旋转后要区分本轮与下一轮的值，不处理
+            for (auto* v : inst->operands) {
+                if (!v->isInstruction()) continue;
+                auto* def = static_cast<Instruction*>(v);
+                if (def->parent == header && !def->isPhi()) return false;
+            }
+            continue;
+        }
+        if (inst->isTerminator()) continue;
+        if (inst->hasSideEffects() || ++size > kMaxHeaderSize) return false;
+    }
+    return true;
+}
+
+// 在 from 末尾复制 header (取代原来的无条件跳转)，header 的 phi 换成沿 from 进入时的值
+ValueMap cloneHeader(BasicBlock* header, BasicBlock* from, RotateStats& stats) {
+    ValueMap map;
+    from->erase(from->terminator());
+    for (auto& inst : header->insts) {
+        if (inst->isPhi()) {
+            map[inst.get()] = inst->getIncomingValue(from);
+            continue;
+        }
+        std::vector<Value*> operands;
+        for (auto* v : inst->operands) operands.push_back(lookup(map, v));
+        auto copy = makeInst(inst->op, inst->type, operands);
+        copy->blocks = inst->blocks;
+        copy->callee = inst->callee;
+        map[inst.get()] = from->append(std::move(copy));
+        if (!inst->isTerminator()) ++stats.duplicated;
+    }
+    return map;
+}
+
+// 来自 header 的 phi 入口拆成来自各个复制了测试的块的入口
+void splitIncoming(BasicBlock* bb, BasicBlock* header, const std::vector<std::pair<BasicBlock*, ValueMap>>& copies) {
+    for (auto& inst : bb->insts) {
+        if (!inst->isPhi()) break;
+        Value* v = inst->getIncomingValue(header);
+        inst->removeIncoming(header);
+        for (auto& [from, map] : copies) inst->addIncoming(lookup(map, v), from);
+    }
+}
+
+void rotate(Function& func, Loop* loop, BasicBlock* body, BasicBlock* exit, RotateStats& stats) {
+    BasicBlock* header = loop->header;
+
+    // 前置块得到守卫，每个回边源块得到底部测试
+    std::vector<std::pair<BasicBlock*, ValueMap>> copies;
+    copies.emplace_back(loop->preheader(), ValueMap());
+    for (auto* latch : loop->latches) copies.emplace_back(latch, ValueMap());
+    for (auto& [from, map] : copies) map = cloneHeader(header, from, stats);
+    splitIncoming(exit, header, copies);
+    splitIncoming(body, header, copies);
+
+    // header 的 phi 移到 body 开头：body 的前驱正是 header 原来的前驱
+    std::vector<Instruction*> phis, computed;
+    for (auto& inst : header->insts) {
+        if (inst->isPhi()) phis.push_back(inst.get());
+        else if (!inst->isTerminator()) computed.push_back(inst.get());
+    }
+    for (auto* phi : phis) body->insertAfterPhis(header->remove(phi));
+    body->preds.clear();
+    exit->preds.erase(std::find(exit->preds.begin(), exit->preds.end(), header));
+    for (auto& [from, map] : copies) {
+        body->preds.push_back(from);
+        exit->preds.push_back(from);
+    }
+
+    // 其余使用按到达的定义改写：离开循环时的值在前置块与回边源块末尾，
+    // 循环内 (都被 body 支配) 的值是 body 中的 phi 或其按需建立的 phi。
+    // 来源为这些块的 phi 入口在上面已按边的语义给出，不再改写
+    auto isCopy = [&](const BasicBlock* bb) {
+        return std::any_of(copies.begin(), copies.end(), [&](const auto& c) { return c.first == bb; });
+    };
+    auto rewriteUses = [&](Instruction* v, bool insideLoopValid) {
+        SSAUpdater updater(v->type);
+        for (auto& [from, map] : copies) updater.addDefinition(from, map.at(v));
+        if (insideLoopValid) updater.setEntryValue(body, v);
+        std::vector<Instruction*> users = v->users;
+        std::sort(users.begin(), users.end());
+        users.erase(std::unique(users.begin(), users.end()), users.end());
+        for (auto* user : users) {
+            if (user->parent == header) continue;
+            if (insideLoopValid && loop->contains(user->parent)) continue;
+            for (size_t i = 0; i < user->operands.size(); ++i) {
+                if (user->operands[i] != v) continue;
+                if (user->isPhi() && isCopy(user->blocks[i])) continue;
+                updater.rewriteUse(user, i);
+            }
+        }
+        updater.removeTrivialPhis();
+    };
+    for (auto* phi : phis) rewriteUses(phi, true);
+    for (auto* inst : computed) rewriteUses(inst, false);
+
+    for (auto& inst : header->insts) inst->dropAllOperands();
+    for (auto* inst : computed) {
+        if (!inst->users.empty()) throw std::runtime_error("loop rotation left a use of a value in " + header->name);
+    }
+
+    // 就地更新循环信息，外层循环随后仍按这份信息旋转：header 从本循环与各外层循环中去掉；
+    // header 原是外层的回边源块时 (出口即外层 header)，改由得到测试副本的块跳回
+    for (Loop* l = loop; l; l = l->parent) {
+        l->blocks.erase(std::find(l->blocks.begin(), l->blocks.end(), header));
+        l->blockSet.erase(header);
+        auto latch = std::find(l->latches.begin(), l->latches.end(), header);
+        if (latch == l->latches.end()) continue;
+        l->latches.erase(latch);
+        for (auto& copy : copies) {
+            if (l->contains(copy.first)) l->latches.push_back(copy.first);
+        }
+    }
+    loop->header = body;
+    auto first = std::find(loop->blocks.begin(), loop->blocks.end(), body);
+    std::rotate(loop->blocks.begin(), first, first + 1);
+    func.blocks.erase(std::find_if(func.blocks.begin(), func.blocks.end(),
+        [&](const std::unique_ptr<BasicBlock>& bb) { return bb.get() == header; }));
+}
+
+} // namespace
+
+Preserved runLoopRotate(Function& func, AnalysisManager& am, RotateStats& stats) {
+    // 由内向外旋转，全程使用同一份循环信息：旋转只删去本循环的 header (rotate 中就地修正各层循环)，
+    // 新建的前置块由 ensurePreheader 加入外层循环。每次变换后都重算支配树与循环信息，整遍开销会随循环数平方增长
+    bool changed = false;
+    for (auto* loop : am.loopInfo().loopsInnermostFirst()) {
+        if (loop->header == func.entry()) continue;
+        if (!loop->preheader()) {
+            ensurePreheader(func, loop);
+            changed = true;
+        }
+        BasicBlock* body = nullptr;
+        BasicBlock* exit = nullptr;
+        if (!canRotate(loop, body, exit)) continue;
+        rotate(func, loop, body, exit, stats);
+        ++stats.loops;
+        changed = true;
+    }
+    return changed ? Preserved::None : Preserved::All;
+}
@@ -0,0 +1,15 @@
+#pragma once
+#include "ir.h"
+#include "analysis.h"
+
+struct RotateStats {
+    int loops = 0;        // 转为底部测试的循环
+    int duplicated = 0;   // 复制到守卫与回边源块中的 header 指令
+};
+
+// 循环旋转：while 循环的 header 先测试再进入循环体，每轮迭代要多执行一次跳转。
+// 把 header 的测试复制到前置块 (作为守卫) 和每个回边源块 (作为底部测试，continue 各得一份，
+// 不必先合并回边而多一层 phi)，header 的 phi 移到循环体首块，header 随之删除，
+// 循环变为 "if (c) do { ... } while (c)" 的形式。
+// 只处理 header 只含 phi、少量纯计算与条件跳转，且恰好一条边离开循环的情形
+Preserved runLoopRotate(Function& func, AnalysisManager& am, RotateStats& stats);
@@ -0,0 +1,210 @@
+#include "sccp.h"
+#include <climits>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace {
+
+// 格：Top (尚未确定) > 常量 > Bottom (不是常量)
+struct LatticeValue {
+    enum State { Top, Const, Bottom };
+    State state = Top;
+    int value = 0;
+
+    bool operator==(const LatticeValue& o) const {
+        return state == o.state && (state != Const || value == o.value);
+    }
+};
+
+LatticeValue constant(int v) { return { LatticeValue::Const, v }; }
+LatticeValue bottom() { return { LatticeValue::Bottom, 0 }; }
+
+LatticeValue meet(const LatticeValue& a, const LatticeValue& b) {
+    if (a.state == LatticeValue::Top) return b;
+    if (b.state == LatticeValue::Top) return a;
+    if (a.state == LatticeValue::Bottom || b.state == LatticeValue::Bottom) return bottom();
+    return a.value == b.value ? a : bottom();
+}
+
+// 按 32 位补码求值；除以 0 与 INT_MIN / -1 留到运行时
+LatticeValue fold(Opcode op, int a, int b) {
+    uint32_t ua = static_cast<uint32_t>(a);
+    uint32_t ub = static_cast<uint32_t>(b);
+    switch (op) {
+    case Opcode::Add: return constant(static_cast<int>(ua + ub));
+    case Opcode::Sub: return constant(static_cast<int>(ua - ub));
+    case Opcode::Mul: return constant(static_cast<int>(ua * ub));
+    case Opcode::Shl: return constant(static_cast<int>(ua << (ub & 31)));
+    case Opcode::Div:
+    case Opcode::Rem:
+        if (b == 0 || (a == INT_MIN && b == -1)) return bottom();
+        return constant(op == Opcode::Div ? a / b : a % b);
+    case Opcode::Lt: return constant(a < b);
+    case Opcode::Gt: return constant(a > b);
+    case Opcode::Le: return constant(a <= b);
+    case Opcode::Ge: return constant(a >= b);
+    case Opcode::Eq: return constant(a == b);
+    case Opcode::Ne: return constant(a != b);
+    default: return bottom();
+    }
+}
+
+class Solver {
+public:
+    explicit Solver(Function& func) : func(func) {}
+
+    void solve() {
+        markExecutable(func.entry());
+        while (!blockWork.empty() || !valueWork.empty()) {
+            while (!valueWork.empty()) {
+                Instruction* inst = valueWork.back();
+                valueWork.pop_back();
+                if (executable.count(inst->parent)) visit(inst);
+            }
+            while (!blockWork.empty()) {
+                BasicBlock* bb = blockWork.back();
+                blockWork.pop_back();
+                for (auto& inst : bb->insts) visit(inst.get());
+            }
+        }
+    }
+
+    LatticeValue get(const Value* v) const {
+        if (v->isConstant()) return constant(static_cast<const Constant*>(v)->value);
+        if (v->isArgument()) return bottom();
+        auto it = values.find(v);
+        return it == values.end() ? LatticeValue() : it->second;
+    }
+
+    bool isExecutable(const BasicBlock* bb) const { return executable.count(bb) != 0; }
+    bool isExecutable(const BasicBlock* from, const BasicBlock* to) const { return edges.count({ from, to }) != 0; }
+
+private:
+    Function& func;
+    std::unordered_map<const Value*, LatticeValue> values;
+    std::unordered_set<const BasicBlock*> executable;
+    std::set<std::pair<const BasicBlock*, const BasicBlock*>> edges;
+    std::vector<BasicBlock*> blockWork;
+    std::vector<Instruction*> valueWork;
+
+    void markExecutable(BasicBlock* bb) {
+        if (executable.insert(bb).second) blockWork.push_back(bb);
+    }
+
+    // 新的可执行边：目标块首次可达时整块求值，否则只需重算其 phi
+    void markEdge(BasicBlock* from, BasicBlock* to) {
+        if (!edges.insert({ from, to }).second) return;
+        if (!executable.count(to)) {
+            markExecutable(to);
+            return;
+        }
+        for (auto& inst : to->insts) {
+            if (!inst->isPhi()) break;
+            visit(inst.get());
+        }
+    }
+
+    void update(Instruction* inst, const LatticeValue& v) {
+        LatticeValue& old = values[inst];
+        if (old == v) return;
+        old = v;
+        for (auto* user : inst->users) valueWork.push_back(user);
+    }
+
+    void visit(Instruction* inst) {
+        switch (inst->op) {
+        case Opcode::Phi: {
+            LatticeValue v;
+            for (size_t i = 0; i < inst->operands.size(); ++i) {
+                if (isExecutable(inst->blocks[i], inst->parent)) v = meet(v, get(inst->operands[i]));
+            }
+            update(inst, v);
+            return;
+        }
+        case Opcode::Br:
+            markEdge(inst->parent, inst->blocks[0]);
+            return;
+        case Opcode::CondBr: {
+            LatticeValue cond = get(inst->getOperand(0));
+            if (cond.state == LatticeValue::Top) return;
+            if (cond.state == LatticeValue::Const) {
+                markEdge(inst->parent, inst->blocks[cond.value != 0 ? 0 : 1]);
+            }
+            else {
+                markEdge(inst->parent, inst->blocks[0]);
+                markEdge(inst->parent, inst->blocks[1]);
+            }
+            return;
+        }
+        case Opcode::Ret:
+            return;
+        case Opcode::Call:
+            update(inst, bottom());
+            return;
+        case Opcode::Copy:
+        case Opcode::ZExt:
+            update(inst, get(inst->getOperand(0)));
+            return;
+        default: {
+            LatticeValue a = get(inst->getOperand(0));
+            LatticeValue b = get(inst->getOperand(1));
+            if (a.state == LatticeValue::Bottom || b.state == LatticeValue::Bottom) update(inst, bottom());
+            else if (a.state == LatticeValue::Const && b.state == LatticeValue::Const) update(inst, fold(inst->op, a.value, b.value));
+            return;
+        }
+        }
+    }
+};
+
+} // namespace
+
+Preserved runSCCP(Function& func, SCCPStats& stats) {
+    Solver solver(func);
+    solver.solve();
+
+    bool cfgChanged = false;
+    bool changed = false;
+    for (auto& bb : func.blocks) {
+        if (!solver.isExecutable(bb.get())) continue;
+        std::vector<Instruction*> dead;
+        for (auto& inst : bb->insts) {
+            if (inst->type == IRType::Void || inst->hasSideEffects()) continue;
+            LatticeValue v = solver.get(inst.get());
+            if (v.state != LatticeValue::Const) continue;
+            inst->replaceAllUsesWith(func.getConstant(v.value));
+            dead.push_back(inst.get());
+        }
+        for (auto* inst : dead) bb->erase(inst);
+        stats.constants += static_cast<int>(dead.size());
+        changed = changed || !dead.empty();
+
+        // 只有一条出边可执行的条件分支改为 br，另一目标去掉来自本块的 phi 入口
+        Instruction* term = bb->terminator();
+        if (!term || term->op != Opcode::CondBr || term->blocks[0] == term->blocks[1]) continue;
+        bool takeTrue = solver.isExecutable(bb.get(), term->blocks[0]);
+        bool takeFalse = solver.isExecutable(bb.get(), term->blocks[1]);
+        if (takeTrue == takeFalse) continue;
+        BasicBlock* target = term->blocks[takeTrue ? 0 : 1];
+        BasicBlock* dropped = term->blocks[takeTrue ? 1 : 0];
+        for (auto& inst : dropped->insts) {
+            if (!inst->isPhi()) break;
+            inst->removeIncoming(bb.get());
+        }
+        bb->erase(term);
+        auto br = makeInst(Opcode::Br, IRType::Void);
+        br->blocks.push_back(target);
+        bb->append(std::move(br));
+        ++stats.foldedBranches;
+        cfgChanged = true;
+    }
+
+    size_t before = func.blocks.size();
+    if (cfgChanged) {
+        func.recomputePreds();
+        func.removeUnreachableBlocks();
+    }
+    stats.removedBlocks += static_cast<int>(before - func.blocks.size());
+    if (cfgChanged) return Preserved::None;
+    return changed ? Preserved::CFG : Preserved::All;
+}
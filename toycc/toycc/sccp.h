@@ -0,0 +1,14 @@
+#pragma once
+#include "ir.h"
+#include "analysis.h"
+
+struct SCCPStats {
+    int constants = 0;        // 替换为常量的值
+    int foldedBranches = 0;   // 条件已确定、改为无条件跳转的分支
+    int removedBlocks = 0;    // 因此不可达而删除的块
+};
+
+// 稀疏条件常量传播 (Wegman-Zadeck)：在 SSA 边与可执行的 CFG 边上同时传播，
+// phi 只合并来自可执行边的值，因此常量可以穿过分支与循环，条件确定的分支只走一边。
+// 结束后常量值替换其所有使用，确定的分支改为 br，不可达块删除
+Preserved runSCCP(Function& func, SCCPStats& stats);
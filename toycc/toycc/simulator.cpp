@@ -0,0 +1,175 @@
+#include "simulator.h"
+#include <climits>
+#include <cstdint>
+#include <stdexcept>
+
+namespace {
+
+// 栈区：sp 初值为其顶端，只有栈上的访存
+constexpr uint32_t kStackBase = 0x10000000;
+constexpr uint32_t kStackBytes = 8u << 20;
+// 返回地址编码为 (函数编号 + 1) << 20 | 指令下标，ra 为 0 表示从 main 返回
+constexpr int kCodeShift = 20;
+constexpr long long kStepLimit = 4000000000LL;
+// 周期模型中各类指令的额外延迟
+constexpr int kMulLatency = 2;
+constexpr int kDivLatency = 31;
+constexpr int kLoadLatency = 1;
+constexpr int kTakenPenalty = 2;
+
+} // namespace
+
+void Simulator::load(const MachineFunction& func) {
+    Code code;
+    std::unordered_map<std::string_view, int> labels;
+    for (size_t i = 0; i < func.code.size(); ++i) {
+        if (func.code[i].isLabel()) labels[func.code[i].label] = static_cast<int>(i);
+    }
+    for (size_t i = 0; i < func.code.size(); ++i) {
+        const MachineInstr& mi = func.code[i];
+        Inst inst{ mi.op, mi.rd, mi.rs1, mi.rs2, mi.imm, -1 };
+        if (mi.hasTarget()) {
+            auto it = labels.find(mi.label);
+            if (it == labels.end()) throw std::runtime_error("simulator: undefined label " + std::string(mi.label));
+            inst.target = it->second;
+        }
+        else if (mi.op == MOp::Call) {
+            code.calls.emplace_back(i, std::string(mi.label));
+        }
+        code.insts.push_back(inst);
+    }
+    funcIndex[std::string(func.name)] = static_cast<int>(funcs.size());
+    funcs.push_back(std::move(code));
+}
+
+int Simulator::run() {
+    for (auto& code : funcs) {
+        for (auto& [i, callee] : code.calls) {
+            auto it = funcIndex.find(callee);
+            if (it == funcIndex.end()) throw std::runtime_error("simulator: undefined function " + callee);
+            code.insts[i].target = it->second;
+        }
+    }
+    auto entry = funcIndex.find("main");
+    if (entry == funcIndex.end()) throw std::runtime_error("simulator: main not loaded");
+
+    counters = Stats();
+    std::vector<uint8_t> stack(kStackBytes);
+    int32_t x[32] = {};
+    x[static_cast<int>(Reg::sp)] = static_cast<int32_t>(kStackBase + kStackBytes);
+    auto reg = [&](Reg r) -> int32_t& { return x[static_cast<int>(r)]; };
+    auto word = [&](int32_t addr) -> int32_t* {
+        uint32_t offset = static_cast<uint32_t>(addr) - kStackBase;
+        if (offset >= kStackBytes || offset % 4) throw std::runtime_error("simulator: bad memory access");
+        return reinterpret_cast<int32_t*>(stack.data() + offset);
+    };
+
+    int fn = entry->second;
+    size_t pc = 0;
+    while (true) {
+        const auto& insts = funcs[fn].insts;
+        if (pc >= insts.size()) throw std::runtime_error("simulator: fell off the end of a function");
+        const Inst& in = insts[pc++];
+        if (in.op == MOp::Label) continue;
+        if (++counters.instructions > kStepLimit) throw std::runtime_error("simulator: step limit exceeded");
+        ++counters.cycles;
+
+        uint32_t a = static_cast<uint32_t>(in.rs1 == Reg::None ? 0 : reg(in.rs1));
+        uint32_t b = static_cast<uint32_t>(in.rs2 == Reg::None ? 0 : reg(in.rs2));
+        int32_t sa = static_cast<int32_t>(a);
+        int32_t sb = static_cast<int32_t>(b);
+        int32_t result = 0;
+        bool writes = true;
+        bool taken = false;
+        switch (in.op) {
+        case MOp::Li: result = in.imm; break;
+        case MOp::Lui: result = static_cast<int32_t>(static_cast<uint32_t>(in.imm) << 12); break;
+        case MOp::Mv: result = sa; break;
+        case MOp::Neg: result = static_cast<int32_t>(0u - a); break;
+        case MOp::Seqz: result = a == 0; break;
+        case MOp::Snez: result = a != 0; break;
+        case MOp::Add: result = static_cast<int32_t>(a + b); break;
+        case MOp::Sub: result = static_cast<int32_t>(a - b); break;
+        case MOp::Mul:
+            result = static_cast<int32_t>(a * b);
+            counters.cycles += kMulLatency;
+            break;
+        case MOp::Div:
+            counters.cycles += kDivLatency;
+            // RISC-V 的除法不陷入：除以 0 得 -1，INT_MIN / -1 得 INT_MIN
+            if (sb == 0) result = -1;
+            else if (sa == INT_MIN && sb == -1) result = INT_MIN;
+            else result = sa / sb;
+            break;
+        case MOp::Rem:
+            counters.cycles += kDivLatency;
+            if (sb == 0) result = sa;
+            else if (sa == INT_MIN && sb == -1) result = 0;
+            else result = sa % sb;
+            break;
+        case MOp::Sll: result = static_cast<int32_t>(a << (b & 31)); break;
+        case MOp::Slt: result = sa < sb; break;
+        case MOp::Addi: result = static_cast<int32_t>(a + static_cast<uint32_t>(in.imm)); break;
+        case MOp::Slti: result = sa < in.imm; break;
+        case MOp::Andi: result = sa & in.imm; break;
+        case MOp::Xori: result = sa ^ in.imm; break;
+        case MOp::Slli: result = static_cast<int32_t>(a << (in.imm & 31)); break;
+        case MOp::Srli: result = static_cast<int32_t>(a >> (in.imm & 31)); break;
+        case MOp::Srai: result = sa >> (in.imm & 31); break;
+        case MOp::Lw:
+            result = *word(sa + in.imm);
+            counters.cycles += kLoadLatency;
+            break;
+        case MOp::Sw:
+            *word(sa + in.imm) = sb;
+            writes = false;
+            break;
+        case MOp::Beq: taken = sa == sb; break;
+        case MOp::Bne: taken = sa != sb; break;
+        case MOp::Blt: taken = sa < sb; break;
+        case MOp::Bge: taken = sa >= sb; break;
+        case MOp::Beqz: taken = sa == 0; break;
+        case MOp::Bnez: taken = sa != 0; break;
+        case MOp::Bltz: taken = sa < 0; break;
+        case MOp::Bgez: taken = sa >= 0; break;
+        case MOp::Blez: taken = sa <= 0; break;
+        case MOp::Bgtz: taken = sa > 0; break;
+        case MOp::J:
+            ++counters.jumps;
+            counters.cycles += kTakenPenalty;
+            pc = in.target;
+            writes = false;
+            break;
+        case MOp::Call:
+            ++counters.jumps;
+            counters.cycles += kTakenPenalty;
+            reg(Reg::ra) = static_cast<int32_t>(((fn + 1) << kCodeShift) | static_cast<int>(pc));
+            fn = in.target;
+            pc = 0;
+            writes = false;
+            break;
+        case MOp::Ret: {
+            ++counters.jumps;
+            counters.cycles += kTakenPenalty;
+            int32_t ra = reg(Reg::ra);
+            if (ra == 0) return reg(Reg::a0);
+            fn = (ra >> kCodeShift) - 1;
+            pc = ra & ((1 << kCodeShift) - 1);
+            writes = false;
+            break;
+        }
+        default:
+            throw std::runtime_error(std::string("simulator: unsupported instruction ") + opName(in.op));
+        }
+        if (in.op >= MOp::Beq && in.op <= MOp::Bgtz) {
+            ++counters.branches;
+            if (taken) {
+                ++counters.takenBranches;
+                counters.cycles += kTakenPenalty;
+                pc = in.target;
+            }
+            writes = false;
+        }
+        if (writes && in.rd != Reg::None && in.rd != Reg::zero) reg(in.rd) = result;
+    }
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include "machine.h"
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// 直接执行生成的机器代码 (RV32IM 中用到的子集)：逐函数装入窥孔优化后的指令，从 main 开始
+// 运行到其返回，统计动态指令数与控制转移，用来衡量块布局、循环变换对分支的影响。
+// 周期数按简单的单发射顺序流水线估计：每条指令 1 拍，乘法、除法、访存另加延迟，
+// 发生跳转的分支与 j/call/ret 另加冲刷流水线的代价
+class Simulator {
+public:
+    struct Stats {
+        long long instructions = 0;
+        long long cycles = 0;
+        long long branches = 0;        // 执行的条件分支
+        long long takenBranches = 0;   // 其中发生跳转的
+        long long jumps = 0;           // j、call 与 ret
+    };
+
+    void load(const MachineFunction& func);   // 标签在装入时解析为指令下标
+    int run();                                // 返回 main 的 a0
+    const Stats& stats() const { return counters; }
+
+private:
+    struct Inst {
+        MOp op;
+        Reg rd, rs1, rs2;
+        int imm;
+        int target;   // 跳转目标的指令下标，call 为被调函数编号
+    };
+    struct Code {
+        std::vector<Inst> insts;
+        std::vector<std::pair<size_t, std::string>> calls;   // 待解析的被调函数名
+    };
+
+    std::vector<Code> funcs;
+    std::unordered_map<std::string, int> funcIndex;
+    Stats counters;
+};
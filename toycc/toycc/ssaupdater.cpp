@@ -0,0 +1,64 @@
+#include "ssaupdater.h"
+#include <stdexcept>
+
+void SSAUpdater::addDefinition(BasicBlock* bb, Value* v) {
+    defs[bb] = v;
+}
+
+void SSAUpdater::setEntryValue(BasicBlock* bb, Value* v) {
+    entry[bb] = v;
+}
+
+Value* SSAUpdater::valueAtEnd(BasicBlock* bb) {
+    auto it = defs.find(bb);
+    return it != defs.end() ? it->second : valueAtEntry(bb);
+}
+
+Value* SSAUpdater::valueAtEntry(BasicBlock* bb) {
+    auto it = entry.find(bb);
+    if (it != entry.end()) return it->second;
+    if (bb->preds.empty()) throw std::runtime_error("SSAUpdater: value undefined on entry to " + bb->name);
+    if (bb->preds.size() == 1) {
+        Value* v = valueAtEnd(bb->preds[0]);
+        entry[bb] = v;
+        return v;
+    }
+    // 先登记 phi 再求各入口，回边上的查找因此会停在这里
+    auto* phi = bb->insertBefore(bb->insts.front().get(), makeInst(Opcode::Phi, type));
+    entry[bb] = phi;
+    phis.push_back(phi);
+    for (auto* pred : bb->preds) phi->addIncoming(valueAtEnd(pred), pred);
+    return phi;
+}
+
+void SSAUpdater::rewriteUse(Instruction* user, size_t i) {
+    Value* v = user->isPhi() ? valueAtEnd(user->blocks[i]) : valueAtEntry(user->parent);
+    user->setOperand(i, v);
+}
+
+int SSAUpdater::removeTrivialPhis() {
+    std::vector<bool> removed(phis.size(), false);
+    bool progress = true;
+    while (progress) {
+        progress = false;
+        for (size_t k = 0; k < phis.size(); ++k) {
+            if (removed[k]) continue;
+            Instruction* phi = phis[k];
+            Value* same = nullptr;
+            bool trivial = true;
+            for (auto* v : phi->operands) {
+                if (v == phi || v == same) continue;
+                if (same) trivial = false;
+                same = v;
+            }
+            if (!trivial || !same) continue;
+            phi->replaceAllUsesWith(same);
+            phi->parent->erase(phi);
+            removed[k] = true;
+            progress = true;
+        }
+    }
+    int kept = 0;
+    for (bool r : removed) kept += !r;
+    return kept;
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include "ir.h"
+#include <unordered_map>
+#include <vector>
+
+// 复制或移动代码后为一个值重建 SSA：登记它在若干块出口 (或入口) 处的定义，
+// 使用处按控制流向上查找到达的定义，多前驱的块按需建立 phi (Braun 等人的做法)。
+// 定义都视为位于块末尾，同块中先于它的使用取入口处的值
+class SSAUpdater {
+public:
+    explicit SSAUpdater(IRType type = IRType::I32) : type(type) {}
+
+    void addDefinition(BasicBlock* bb, Value* v);   // bb 出口处的值
+    void setEntryValue(BasicBlock* bb, Value* v);   // bb 入口处已有的值，如块中的 phi
+
+    Value* valueAtEnd(BasicBlock* bb);
+    Value* valueAtEntry(BasicBlock* bb);
+
+    // 改写 user 的第 i 个操作数：phi 取对应来源块出口的值，其余取所在块入口的值
+    void rewriteUse(Instruction* user, size_t i);
+
+    // 改写结束后删去新建 phi 中各入口相同的，返回保留下来的 phi 个数
+    int removeTrivialPhis();
+
+private:
+    IRType type;
+    std::unordered_map<const BasicBlock*, Value*> defs;
+    std::unordered_map<const BasicBlock*, Value*> entry;
+    std::vector<Instruction*> phis;
+};
@@ -0,0 +1,154 @@
+#!/usr/bin/env python3
+# ToyC 回归测试：以各优化级别编译 tests/*.tc，用 toyc --run 在内置模拟器上执行，核对 main 的返回值
+# 用法: python run_tests.py <toyc> [name ...]
+# 每个测试程序开头以注释写明期望结果：
+#   // expect: N                      main 应返回 N (各级别一致)
+#   // report <flags>: <pass> <counter> <op> N
+#                                     以 <flags> 加 --opt-report 编译时，该遍的计数器须满足比较，
+#                                     用于确认测试确实走到了要覆盖的变换，如 "// report -O1: gvn expressions >= 7"
+# 不指定测试名时还检查编译时间随输入规模的增长 (见 SCALING)
+import os
+import re
+import subprocess
+import sys
+import tempfile
+import time
+
+CONFIGS = [["-O0"], ["-O1"], ["-O2"], ["-O3"], ["-O2", "-funroll-loops"], ["-O3", "-funroll-loops"]]
+# (bench/gen_bench.py 的种类, 小规模, 大规模, 编译选项)：规模增至 4 倍时线性增长约 4 倍、平方增长约 16 倍，
+# 超过 SCALING_LIMIT 倍即视为某一遍的开销随循环数等超线性增长
+SCALING = [("loops", 100, 400, ["-O1"]), ("loops", 100, 400, ["-O3"])]
+SCALING_LIMIT = 10
+OPS = {"==": int.__eq__, "!=": int.__ne__, ">=": int.__ge__, "<=": int.__le__, ">": int.__gt__, "<": int.__lt__}
+
+
+def parse_header(path):
+    expect, reports = None, []
+    with open(path, encoding="utf-8") as f:
+        for line in f:
+            m = re.match(r"\s*//\s*expect:\s*(-?\d+)", line)
+            if m:
+                expect = int(m.group(1))
+                continue
+            m = re.match(r"\s*//\s*report\s+([^:]+):\s*(\w+)\s+(\w+)\s*(==|!=|>=|<=|>|<)\s*(-?\d+)", line)
+            if m:
+                reports.append((m.group(1).split(), m.group(2), m.group(3), m.group(4), int(m.group(5))))
+    return expect, reports
+
+
+def last_line(out):
+    lines = out.strip().splitlines()
+    return lines[-1] if lines else ""
+
+
+def compile_and_run(toyc, path, flags):
+    with tempfile.TemporaryDirectory() as tmp:
+        cmd = [toyc, path, "-o", os.path.join(tmp, "out.s")] + flags
+        proc = subprocess.run(cmd, capture_output=True, text=True, timeout=120)
+    return proc.returncode == 0, proc.stdout + proc.stderr
+
+
+def returned(out):
+    m = re.search(r"\[RUN\] main returned (-?\d+)", out)
+    return int(m.group(1)) if m else None
+
+
+def counters(out):
+    # "[OPT] gvn: 7 expressions, 0 copies, 1 phis"
+    result = {}
+    for m in re.finditer(r"^\[OPT\] (\w+): (.*)$", out, re.M):
+        for n, name in re.findall(r"(-?\d+) (\w+)", m.group(2)):
+            result[(m.group(1), name)] = int(n)
+    return result
+
+
+def run_test(toyc, path):
+    errors = []
+    expect, reports = parse_header(path)
+    if expect is None:
+        return ["missing '// expect: N' header"]
+    for flags in CONFIGS:
+        ok, out = compile_and_run(toyc, path, flags + ["--run"])
+        if not ok:
+            errors.append(f"{' '.join(flags)}: compile failed: {last_line(out)}")
+            continue
+        got = returned(out)
+        if got != expect:
+            errors.append(f"{' '.join(flags)}: expected {expect}, got {got}")
+    for flags, pass_name, counter, op, n in reports:
+        ok, out = compile_and_run(toyc, path, flags + ["--opt-report"])
+        if not ok:
+            errors.append(f"{' '.join(flags)}: compile failed: {last_line(out)}")
+            continue
+        value = counters(out).get((pass_name, counter))
+        if value is None or not OPS[op](value, n):
+            errors.append(f"{' '.join(flags)}: {pass_name} {counter} = {value}, want {op} {n}")
+    return errors
+
+
+def compile_time(toyc, path, flags):
+    # 取 3 次中最快的一次，减少机器负载的影响
+    best = None
+    for _ in range(3):
+        start = time.perf_counter()
+        ok, out = compile_and_run(toyc, path, flags)
+        if not ok:
+            return None
+        elapsed = time.perf_counter() - start
+        best = elapsed if best is None else min(best, elapsed)
+    return best
+
+
+def check_scaling(toyc, here):
+    errors = []
+    gen = os.path.join(here, "..", "bench", "gen_bench.py")
+    with tempfile.TemporaryDirectory() as tmp:
+        for kind, small, large, flags in SCALING:
+            times = []
+            for n in (small, large):
+                path = os.path.join(tmp, f"{kind}{n}.tc")
+                with open(path, "w", encoding="utf-8") as f:
+                    subprocess.run([sys.executable, gen, kind, str(n)], stdout=f, check=True)
+                times.append(compile_time(toyc, path, flags))
+            label = f"{kind} {small} -> {large} {' '.join(flags)}"
+            if None in times:
+                errors.append(f"{label}: compile failed")
+            elif times[1] > SCALING_LIMIT * times[0]:
+                errors.append(f"{label}: {times[0]:.2f}s -> {times[1]:.2f}s, more than {SCALING_LIMIT}x")
+    return errors
+
+
+def main():
+    if len(sys.argv) < 2:
+        print("usage: run_tests.py <toyc> [name ...]", file=sys.stderr)
+        sys.exit(1)
+    toyc = os.path.abspath(sys.argv[1])
+    here = os.path.dirname(os.path.abspath(__file__))
+    names = sys.argv[2:] or sorted(f[:-3] for f in os.listdir(here) if f.endswith(".tc"))
+    failed = 0
+    for name in names:
+        errors = run_test(toyc, os.path.join(here, name + ".tc"))
+        if errors:
+            failed += 1
+            print(f"FAIL {name}")
+            for e in errors:
+                print("    " + e)
+        else:
+            print(f"ok   {name}")
+    total = len(names)
+    if len(sys.argv) == 2:
+        total += 1
+        errors = check_scaling(toyc, here)
+        if errors:
+            failed += 1
+            print("FAIL compile-time scaling")
+            for e in errors:
+                print("    " + e)
+        else:
+            print("ok   compile-time scaling")
+    print(f"{total - failed} passed, {failed} failed")
+    sys.exit(1 if failed else 0)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,402 @@
+#include "unroll.h"
+#include "looputil.h"
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace {
+
+// 完全展开：迭代次数与展开后的总指令数上限
+constexpr int kMaxFullTrip = 16;
+constexpr int kFullUnrollSize = 96;
+// 部分展开后主循环的指令数上限
+constexpr int kPartialUnrollSize = 48;
+// 估计的迭代次数不足倍数的这么多倍时不部分展开：大部分时间会花在入口测试与余数循环上
+constexpr int kMinPartialTrips = 3;
+// 可分配的寄存器数 (调用者保存与被调用者保存各 12 个)
+constexpr int kRegisters = 24;
+
+// 计数循环：回边源块 latch 以 "iv 与不变量 bound 比较" 决定是否继续
+struct CountedLoop {
+    Loop* loop;
+    BasicBlock* pre;
+    BasicBlock* latch;
+    BasicBlock* exit;
+    Instruction* iv;       // header 中的计数器 phi
+    Instruction* next;     // 回边带回的 iv + step
+    int step;
+    Value* tested;         // 比较的是 iv 还是 next
+    Value* bound;
+    Opcode op;             // 继续循环的条件: tested op bound
+};
+
+bool findCounter(Loop* loop, CountedLoop& c);
+
+class Unroller {
+public:
+    Unroller(Function& func, CountedLoop& c, int maxFactor, UnrollStats& stats)
+        : func(func), c(c), loop(c.loop), header(c.loop->header), maxFactor(maxFactor), stats(stats) {}
+
+    bool run() {
+        int size = loopSize(loop);
+        int trip = tripCount();
+        if (trip > 0 && trip * size <= kFullUnrollSize) {
+            prepare();
+            unrollFully(trip);
+            return true;
+        }
+        int factor = std::min(maxFactor, kPartialUnrollSize / std::max(size, 1));
+        if (trip > 0) factor = std::min(factor, trip);
+        factor = std::min(factor, pressureLimit());
+        if (factor < 2 || !canUnrollPartially(factor)) return false;
+        if (trip == 0 && expectedTripCount() < static_cast<long long>(kMinPartialTrips) * factor) return false;
+        prepare();
+        unrollPartially(factor);
+        return true;
+    }
+
+private:
+    Function& func;
+    CountedLoop& c;
+    Loop* loop;
+    BasicBlock* header;
+    int maxFactor;
+    UnrollStats& stats;
+
+    std::vector<Instruction*> phis;
+    std::unordered_map<const Instruction*, Value*> latchValues;        // header phi 沿回边的值
+    LoopExits exits;
+    std::vector<std::pair<Instruction*, std::vector<Value*>>> exitPhis; // 出口块 phi 在各出口边上的值
+    std::vector<LoopCopy> copies;   // 第 k 份迭代，copies[0] 为原循环
+
+    // 初值、步长、边界都是常量时模拟计数器求出迭代次数，超过上限或会溢出时返回 0
+    int tripCount() const {
+        const Constant* init = asConstant(c.iv->getIncomingValue(c.pre));
+        const Constant* bound = asConstant(c.bound);
+        if (!init || !bound) return 0;
+        long long v = init->value;
+        if (c.tested == c.next) v += c.step;
+        for (int k = 1; k <= kMaxFullTrip; ++k, v += c.step) {
+            if (v < INT_MIN || v > INT_MAX) return 0;
+            if (!evaluateCompare(c.op, v, bound->value)) return k;
+        }
+        return 0;
+    }
+
+    // 边界是外层循环的计数器且其初值、边界都是常量时 (如三角形循环 "j < i")，
+    // 按外层计数器在其范围内均匀取值估计平均迭代次数；无从估计时返回 LLONG_MAX
+    long long expectedTripCount() const {
+        const Constant* init = asConstant(c.iv->getIncomingValue(c.pre));
+        if (!init || !c.bound->isInstruction()) return LLONG_MAX;
+        auto* bound = static_cast<Instruction*>(c.bound);
+        for (Loop* outer = loop->parent; outer; outer = outer->parent) {
+            if (outer->header != bound->parent) continue;
+            CountedLoop o;
+            if (!findCounter(outer, o) || o.iv != bound) return LLONG_MAX;
+            const Constant* first = asConstant(o.iv->getIncomingValue(o.pre));
+            const Constant* last = asConstant(o.bound);
+            if (!first || !last) return LLONG_MAX;
+            long long distance = std::llabs(static_cast<long long>(first->value) - init->value) +
+                std::llabs(static_cast<long long>(last->value) - init->value);
+            return distance / 2 / std::abs(c.step);
+        }
+        return LLONG_MAX;
+    }
+
+    // 各份之间传递的 phi 同时存活，连同循环中用到的不变量不能超出可分配的寄存器
+    int pressureLimit() const {
+        std::unordered_set<const Value*> invariants;
+        int carried = 0;
+        for (auto* bb : loop->blocks) {
+            for (auto& inst : bb->insts) {
+                if (inst->isPhi() && bb == header) ++carried;
+                for (auto* v : inst->operands) {
+                    if (v->isArgument() || (v->isInstruction() && !loop->contains(static_cast<const Instruction*>(v)->parent))) {
+                        invariants.insert(v);
+                    }
+                }
+            }
+        }
+        int free = kRegisters - static_cast<int>(invariants.size());
+        return carried > 0 ? free / carried : maxFactor;
+    }
+
+    // 主循环的测试改为 next op bound - (U - 1) * step，要求测的是 next 且方向与步长一致
+    bool canUnrollPartially(int factor) const {
+        if (c.tested != c.next) return false;
+        bool up = c.op == Opcode::Lt || c.op == Opcode::Le;
+        bool down = c.op == Opcode::Gt || c.op == Opcode::Ge;
+        if (!(c.step > 0 && up) && !(c.step < 0 && down)) return false;
+        long long delta = static_cast<long long>(factor - 1) * c.step;
+        if (delta < INT_MIN || delta > INT_MAX) return false;
+        if (const Constant* bound = asConstant(c.bound)) {
+            long long adjusted = bound->value - delta;
+            if (adjusted < INT_MIN || adjusted > INT_MAX) return false;
+        }
+        return true;
+    }
+
+    // 记下变换前的回边值与出口边上的值
+    void prepare() {
+        for (auto& inst : header->insts) {
+            if (!inst->isPhi()) break;
+            phis.push_back(inst.get());
+            latchValues[inst.get()] = inst->getIncomingValue(c.latch);
+        }
+        exits = findLoopExits(loop);
+        for (auto& inst : c.exit->insts) {
+            if (!inst->isPhi()) break;
+            std::vector<Value*> values;
+            for (auto& [from, to] : exits.edges) values.push_back(inst->getIncomingValue(from));
+            exitPhis.emplace_back(inst.get(), values);
+        }
+        copies.emplace_back();
+    }
+
+    // 第 k 份迭代中 v 的值；后续各份的 header phi 取前一份沿回边带回的值
+    Value* valueIn(size_t k, Value* v) const {
+        if (v->isInstruction() && static_cast<Instruction*>(v)->parent == header && static_cast<Instruction*>(v)->isPhi()) {
+            if (k == 0) return v;
+            return valueIn(k - 1, latchValues.at(static_cast<Instruction*>(v)));
+        }
+        return copies[k].value(v);
+    }
+
+    void replaceTerminator(BasicBlock* bb, std::unique_ptr<Instruction> term) {
+        bb->erase(bb->terminator());
+        bb->append(std::move(term));
+    }
+
+    std::unique_ptr<Instruction> jump(BasicBlock* to) {
+        auto br = makeInst(Opcode::Br, IRType::Void);
+        br->blocks.push_back(to);
+        return br;
+    }
+
+    std::unique_ptr<Instruction> branch(Value* cond, BasicBlock* t, BasicBlock* f) {
+        auto br = makeInst(Opcode::CondBr, IRType::Void, { cond });
+        br->blocks = { t, f };
+        return br;
+    }
+
+    // 再复制 count 份迭代串在原循环之后：前一份的回边改为跳到下一份开头，
+    // 副本中 header 的 phi 由前一份的值代替
+    void chainCopies(int count) {
+        for (int k = 1; k <= count; ++k) {
+            copies.push_back(cloneLoop(func, loop));
+            LoopCopy& copy = copies.back();
+            replaceTerminator(copies[k - 1].block(c.latch), jump(copy.block(header)));
+            for (auto* phi : phis) {
+                auto* clone = static_cast<Instruction*>(copy.values.at(phi));
+                clone->replaceAllUsesWith(valueIn(k - 1, latchValues.at(phi)));
+                copy.block(header)->erase(clone);
+            }
+            // 副本中的 break 等出口同样通向出口块
+            for (size_t e = 0; e < exits.edges.size(); ++e) {
+                if (exits.edges[e].first == c.latch) continue;
+                for (auto& [phi, values] : exitPhis) phi->addIncoming(valueIn(k, values[e]), copy.block(exits.edges[e].first));
+            }
+        }
+        stats.copies += count;
+    }
+
+    size_t latchEdge() const {
+        for (size_t e = 0; e < exits.edges.size(); ++e) {
+            if (exits.edges[e].first == c.latch) return e;
+        }
+        return 0;
+    }
+
+    void unrollFully(int trip) {
+        chainCopies(trip - 1);
+        size_t last = copies.size() - 1;
+        BasicBlock* lastLatch = copies[last].block(c.latch);
+        replaceTerminator(lastLatch, jump(c.exit));
+        size_t e = latchEdge();
+        for (auto& [phi, values] : exitPhis) {
+            Value* v = valueIn(last, values[e]);
+            phi->removeIncoming(c.latch);
+            phi->addIncoming(v, lastLatch);
+        }
+        repairUsesAfterLoop(lastLatch, nullptr);
+        // 第一份迭代取进入循环时的值
+        for (auto* phi : phis) {
+            phi->replaceAllUsesWith(phi->getIncomingValue(c.pre));
+            header->erase(phi);
+        }
+        ++stats.full;
+    }
+
+    // 循环后直接使用的值现在有多个到达的定义：各份的 break 出口、latchExit 处
+    // (最后一份的值) 与余数循环的各出口，按需在汇合处建立 phi
+    void repairUsesAfterLoop(BasicBlock* latchExit, const LoopCopy* rest) {
+        if (exits.escaping.empty()) return;
+        func.recomputePreds();
+        size_t last = copies.size() - 1;
+        repairEscapingUses(exits, [&](Instruction* v, SSAUpdater& updater) {
+            for (size_t k = 0; k <= last; ++k) {
+                for (auto& [from, to] : exits.edges) {
+                    if (from != c.latch) updater.addDefinition(copies[k].block(from), valueIn(k, v));
+                }
+            }
+            updater.addDefinition(latchExit, valueIn(last, v));
+            if (rest) {
+                for (auto& [from, to] : exits.edges) updater.addDefinition(rest->block(from), rest->value(v));
+            }
+        });
+    }
+
+    Instruction* emitCompare(BasicBlock* bb, Opcode op, Value* a, Value* b) {
+        return bb->insertBeforeTerminator(makeInst(op, IRType::I1, { a, b }));
+    }
+
+    void unrollPartially(int factor) {
+        Value* init = c.iv->getIncomingValue(c.pre);
+
+        // 余数循环照原样复制，须在串接各份之前
+        LoopCopy remainder = cloneLoop(func, loop);
+        chainCopies(factor - 1);
+        size_t last = copies.size() - 1;
+
+        BasicBlock* remPre = func.createBlock("remainder");
+        BasicBlock* mainExit = func.createBlock("unrolled_exit");
+        BasicBlock* lastLatch = copies[last].block(c.latch);
+
+        // 前置块：bound - (U - 1) * step 不回绕且至少还剩 U 次迭代时进入主循环
+        BasicBlock* pre = c.pre;
+        pre->erase(pre->terminator());
+        Value* adjusted;
+        const Constant* bound = asConstant(c.bound);
+        if (bound) {
+            adjusted = func.getConstant(static_cast<int>(bound->value - static_cast<long long>(factor - 1) * c.step));
+        }
+        else {
+            adjusted = pre->append(makeInst(Opcode::Sub, IRType::I32,
+                { c.bound, func.getConstant((factor - 1) * c.step) }));
+            Instruction* noWrap = pre->append(makeInst(c.step > 0 ? Opcode::Lt : Opcode::Gt, IRType::I1, { adjusted, c.bound }));
+            BasicBlock* guard = func.createBlock("unroll_guard");
+            pre->append(branch(noWrap, guard, remPre));
+            for (auto* phi : phis) phi->replaceBlock(c.pre, guard);
+            pre = guard;
+        }
+        Instruction* enter = pre->append(makeInst(c.op, IRType::I1, { init, adjusted }));
+        pre->append(branch(enter, header, remPre));
+
+        // 主循环末尾：下一轮仍能做满 U 次时回到开头，否则到 mainExit 决定是否进入余数循环
+        Value* lastNext = valueIn(last, c.next);
+        Instruction* again = emitCompare(lastLatch, c.op, lastNext, adjusted);
+        replaceTerminator(lastLatch, branch(again, header, mainExit));
+        // 原测试在 mainExit 重新求值，最后一份中的比较留在循环里便成了死代码
+        Instruction* more = mainExit->append(makeInst(c.op, IRType::I1, { lastNext, c.bound }));
+        mainExit->append(branch(more, remPre, c.exit));
+
+        // 余数循环的入口值来自前置块或主循环
+        BasicBlock* remHeader = remainder.block(header);
+        for (auto* phi : phis) {
+            auto entry = makeInst(Opcode::Phi, phi->type);
+            Value* initValue = phi->getIncomingValue(pre);
+            entry->addIncoming(initValue, c.pre);
+            if (pre != c.pre) entry->addIncoming(initValue, pre);
+            entry->addIncoming(valueIn(last, latchValues.at(phi)), mainExit);
+            Instruction* value = remPre->append(std::move(entry));
+            auto* remPhi = static_cast<Instruction*>(remainder.values.at(phi));
+            remPhi->removeIncoming(c.pre);
+            remPhi->addIncoming(value, remPre);
+
+            Value* carried = valueIn(last, latchValues.at(phi));
+            phi->removeIncoming(c.latch);
+            phi->addIncoming(carried, lastLatch);
+        }
+        remPre->append(jump(remHeader));
+
+        // 出口块：原回边出口改由 mainExit 与余数循环到达
+        size_t latchExit = latchEdge();
+        for (auto& [phi, values] : exitPhis) {
+            phi->removeIncoming(c.latch);
+            phi->addIncoming(valueIn(last, values[latchExit]), mainExit);
+            for (size_t e = 0; e < exits.edges.size(); ++e) {
+                phi->addIncoming(remainder.value(values[e]), remainder.block(exits.edges[e].first));
+            }
+        }
+        repairUsesAfterLoop(mainExit, &remainder);
+        ++stats.partial;
+    }
+};
+
+// 识别回边源块以计数器测试决定是否继续的循环 (不限于最内层)，不符合时返回 false
+bool findCounter(Loop* loop, CountedLoop& c) {
+    c.loop = loop;
+    c.pre = loop->preheader();
+    if (!c.pre || loop->latches.size() != 1) return false;
+    c.latch = loop->latches[0];
+    Instruction* term = c.latch->terminator();
+    if (term->op != Opcode::CondBr || !term->operands[0]->isInstruction()) return false;
+    bool continueOnTrue = term->blocks[0] == loop->header;
+    c.exit = term->blocks[continueOnTrue ? 1 : 0];
+    if (loop->contains(c.exit) || term->blocks[continueOnTrue ? 0 : 1] != loop->header) return false;
+
+    auto* cmp = static_cast<Instruction*>(term->operands[0]);
+    if (!cmp->isCompare() || !loop->contains(cmp->parent)) return false;
+    for (auto& inst : loop->header->insts) {
+        if (!inst->isPhi()) break;
+        Value* v = inst->getIncomingValue(c.latch);
+        if (!v->isInstruction()) continue;
+        auto* next = static_cast<Instruction*>(v);
+        const Constant* step = nullptr;
+        if (next->op == Opcode::Add && next->operands[0] == inst.get()) step = asConstant(next->operands[1]);
+        else if (next->op == Opcode::Add && next->operands[1] == inst.get()) step = asConstant(next->operands[0]);
+        else if (next->op == Opcode::Sub && next->operands[0] == inst.get()) step = asConstant(next->operands[1]);
+        if (!step || step->value == 0 || step->value == INT_MIN) continue;
+
+        Value* a = cmp->operands[0];
+        Value* b = cmp->operands[1];
+        Opcode op = cmp->op;
+        if (b == inst.get() || b == next) {
+            std::swap(a, b);
+            op = swappedCompare(op);
+        }
+        if (a != inst.get() && a != next) continue;
+        if (b->isInstruction() && loop->contains(static_cast<Instruction*>(b)->parent)) continue;
+        c.iv = inst.get();
+        c.next = next;
+        c.step = next->op == Opcode::Sub ? -step->value : step->value;
+        c.tested = a;
+        c.bound = b;
+        c.op = continueOnTrue ? op : negatedCompare(op);
+        return true;
+    }
+    return false;
+}
+
+// 可展开的计数循环：最内层，且所有出口通向同一块
+bool analyze(Function& func, Loop* loop, CountedLoop& c) {
+    if (!loop->subLoops.empty() || loop->header == func.entry() || !findCounter(loop, c)) return false;
+    for (auto* bb : loop->blocks) {
+        for (auto* succ : bb->succs()) {
+            if (!loop->contains(succ) && succ != c.exit) return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+Preserved runLoopUnroll(Function& func, AnalysisManager& am, int maxFactor, UnrollStats& stats) {
+    std::vector<BasicBlock*> headers;
+    for (auto* loop : am.loopInfo().loopsInnermostFirst()) headers.push_back(loop->header);
+
+    bool changed = false;
+    for (auto* header : headers) {
+        Loop* loop = am.loopInfo().loopFor(header);
+        if (!loop || loop->header != header) continue;
+        CountedLoop counted;
+        if (!analyze(func, loop, counted)) continue;
+        if (!Unroller(func, counted, maxFactor, stats).run()) continue;
+        func.recomputePreds();
+        am.invalidate(Preserved::None);
+        changed = true;
+    }
+    return changed ? Preserved::None : Preserved::All;
+}
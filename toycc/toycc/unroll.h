@@ -0,0 +1,16 @@
+#pragma once
+#include "ir.h"
+#include "analysis.h"
+
+struct UnrollStats {
+    int full = 0;       // 完全展开的循环
+    int partial = 0;    // 部分展开的循环
+    int copies = 0;     // 新复制出的循环体份数 (不含余数循环)
+};
+
+// 循环展开。只处理最内层、单回边、底部测试为计数器与循环不变量比较的循环
+// (即旋转后的 "do { ...; i = i + step; } while (i < n)")，break 等其他出口须都通向同一出口块。
+// 初值、步长、边界都是常量且展开后不太大时完全展开，去掉回边与计数器测试；
+// 否则按循环体大小与寄存器压力选出不超过 maxFactor 的倍数 U 部分展开：
+// 剩余次数不少于 U 时进入每轮做 U 份的主循环，其余迭代在原样复制的余数循环中完成
+Preserved runLoopUnroll(Function& func, AnalysisManager& am, int maxFactor, UnrollStats& stats);
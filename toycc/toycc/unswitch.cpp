@@ -0,0 +1,147 @@
+#include "unswitch.h"
+#include "looputil.h"
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+// 可复制的循环大小 (不含 phi 的指令数) 上限
+constexpr int kMaxLoopSize = 80;
+// 每个函数因复制循环而增加的指令数上限
+constexpr int kGrowthBudget = 240;
+
+bool isInvariant(const Loop* loop, const Value* v) {
+    if (v->isArgument()) return true;
+    return v->isInstruction() && !loop->contains(static_cast<const Instruction*>(v)->parent);
+}
+
+// 循环中以循环不变量为条件的分支所测的条件，没有时返回 nullptr
+Value* invariantCondition(const Loop* loop) {
+    for (auto* bb : loop->blocks) {
+        Instruction* term = bb->terminator();
+        if (!term || term->op != Opcode::CondBr || term->blocks[0] == term->blocks[1]) continue;
+        if (isInvariant(loop, term->operands[0])) return term->operands[0];
+    }
+    return nullptr;
+}
+
+class Unswitcher {
+public:
+    Unswitcher(Function& func, Loop* loop, DominatorTree& dom)
+        : func(func), loop(loop), header(loop->header), pre(loop->preheader()), dom(dom) {}
+
+    void run(Value* cond) {
+        exits = findLoopExits(loop);
+        copy = cloneLoop(func, loop);
+
+        // 副本从出口边到达出口块，出口块的 phi 取副本中的对应值
+        for (auto& [from, to] : exits.edges) {
+            for (auto& inst : to->insts) {
+                if (!inst->isPhi()) break;
+                inst->addIncoming(copy.value(inst->getIncomingValue(from)), copy.block(from));
+            }
+        }
+
+        // 前置块测一次条件，为真进入原循环，为假进入副本
+        pre->erase(pre->terminator());
+        auto br = makeInst(Opcode::CondBr, IRType::Void, { cond });
+        br->blocks = { header, copy.block(header) };
+        pre->append(std::move(br));
+        func.recomputePreds();
+        // 循环后直接使用的值现在可能来自任一版本，在出口处登记两个版本的值。
+        // 只有被定义支配的出口块能到达这些使用处
+        repairEscapingUses(exits, [&](Instruction* v, SSAUpdater& updater) {
+            for (auto& [from, to] : exits.edges) {
+                if (!dom.dominates(v->parent, from)) continue;
+                updater.addDefinition(from, v);
+                updater.addDefinition(copy.block(from), copy.value(v));
+            }
+        });
+
+        // 两个版本中条件各为常量，折叠由它决定的分支
+        specialize(loop->blocks, cond, 1);
+        std::vector<BasicBlock*> cloned;
+        for (auto* bb : loop->blocks) cloned.push_back(copy.block(bb));
+        specialize(cloned, cond, 0);
+        func.recomputePreds();
+        func.removeUnreachableBlocks();
+        func.recomputePreds();
+    }
+
+private:
+    Function& func;
+    Loop* loop;
+    BasicBlock* header;
+    BasicBlock* pre;
+    DominatorTree& dom;
+
+    LoopExits exits;
+    LoopCopy copy;
+
+    // 块中对 cond 的使用换成常量 known，并折叠条件已是常量的分支
+    void specialize(const std::vector<BasicBlock*>& bbs, Value* cond, int known) {
+        for (auto* bb : bbs) {
+            for (auto& inst : bb->insts) {
+                for (size_t i = 0; i < inst->operands.size(); ++i) {
+                    if (inst->operands[i] == cond) inst->setOperand(i, func.getConstant(known));
+                }
+            }
+        }
+        for (auto* bb : bbs) {
+            Instruction* term = bb->terminator();
+            if (term->op != Opcode::CondBr || !term->operands[0]->isConstant()) continue;
+            bool taken = static_cast<Constant*>(term->operands[0])->value != 0;
+            BasicBlock* keep = term->blocks[taken ? 0 : 1];
+            BasicBlock* drop = term->blocks[taken ? 1 : 0];
+            if (drop != keep) {
+                for (auto& inst : drop->insts) {
+                    if (!inst->isPhi()) break;
+                    inst->removeIncoming(bb);
+                }
+            }
+            bb->erase(term);
+            auto br = makeInst(Opcode::Br, IRType::Void);
+            br->blocks.push_back(keep);
+            bb->append(std::move(br));
+        }
+    }
+};
+
+} // namespace
+
+Preserved runLoopUnswitch(Function& func, AnalysisManager& am, UnswitchStats& stats) {
+    int budget = kGrowthBudget;
+    bool changed = false;
+    for (;;) {
+        // 外层循环先于内层：条件对外层也不变时在外层一次外提
+        auto loops = am.loopInfo().loopsInnermostFirst();
+        std::reverse(loops.begin(), loops.end());
+        Loop* target = nullptr;
+        Value* cond = nullptr;
+        for (auto* loop : loops) {
+            if (loop->header == func.entry()) continue;
+            int size = loopSize(loop);
+            if (size > kMaxLoopSize || size > budget) continue;
+            if ((cond = invariantCondition(loop))) {
+                target = loop;
+                break;
+            }
+        }
+        if (!target) break;
+
+        // 前一次外提后两个版本共用的前置块以条件分支结尾，先补上各自的前置块
+        if (!target->preheader()) {
+            ensurePreheader(func, target);
+        }
+        else {
+            int size = loopSize(target);
+            Unswitcher(func, target, am.domTree()).run(cond);
+            budget -= size;
+            ++stats.branches;
+            stats.cloned += size;
+        }
+        am.invalidate(Preserved::None);
+        changed = true;
+    }
+    return changed ? Preserved::None : Preserved::All;
+}
@@ -0,0 +1,14 @@
+#pragma once
+#include "ir.h"
+#include "analysis.h"
+
+struct UnswitchStats {
+    int branches = 0;   // 移出循环的不变条件分支
+    int cloned = 0;     // 为此复制的指令数
+};
+
+// 循环外提条件 (unswitching)：循环中按循环不变量 c 做的条件分支每轮都要重新测试。
+// 把整个循环复制一份，前置块中测一次 c，原循环中 c 换为真、副本中换为假，
+// 折叠由此确定的分支并删去走不到的块，两个版本中都不再有这个测试。
+// 在能外提的最外层循环上进行；每次复制整个循环，受单个循环大小与整个函数的增长预算限制
+Preserved runLoopUnswitch(Function& func, AnalysisManager& am, UnswitchStats& stats);